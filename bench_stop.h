@@ -0,0 +1,82 @@
+#ifndef BENCH_STOP_H
+#define BENCH_STOP_H
+
+// Fixed-duration runs (--duration=<sec>): once the workers are released,
+// one thread calls bench_stop_start(seconds) and a coordinator thread
+// sleeps for that long and raises the stop flag.  Workers poll
+// bench_should_stop() once per operation; the flag sits on its own cache
+// line and is only written once, so the poll is a read hit until the
+// very end.  A process that runs several timed phases calls
+// bench_stop_reset() before creating the workers of each.
+//
+// Plain C so the .c harnesses can include it as well.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static struct {
+    int stop;
+    char pad[64 - sizeof(int)];
+} bench_stop_flag __attribute__((aligned(64)));
+
+static pthread_t bench_stop_thread;
+static int bench_stop_started;
+static double bench_stop_seconds;
+
+static inline int bench_should_stop(void) {
+    return __atomic_load_n(&bench_stop_flag.stop, __ATOMIC_RELAXED);
+}
+
+static inline void bench_stop_now(void) {
+    __atomic_store_n(&bench_stop_flag.stop, 1, __ATOMIC_RELEASE);
+}
+
+static void* bench_stop_coordinator(void* arg) {
+    (void)arg;
+    struct timespec ts;
+    ts.tv_sec = (time_t)bench_stop_seconds;
+    ts.tv_nsec = (long)((bench_stop_seconds - ts.tv_sec) * 1e9);
+    while (nanosleep(&ts, &ts) != 0)
+        ;
+    bench_stop_now();
+    return NULL;
+}
+
+// Clear the flag of a previous run; call before the workers are created,
+// never once they may already be polling it
+static inline void bench_stop_reset(void) {
+    __atomic_store_n(&bench_stop_flag.stop, 0, __ATOMIC_RELAXED);
+}
+
+static inline void bench_stop_start(double seconds) {
+    bench_stop_seconds = seconds;
+    bench_stop_started = pthread_create(&bench_stop_thread, NULL, bench_stop_coordinator, NULL) == 0;
+}
+
+// No-op unless bench_stop_start() was called
+static inline void bench_stop_join(void) {
+    if (bench_stop_started)
+        pthread_join(bench_stop_thread, NULL);
+    bench_stop_started = 0;
+}
+
+// Pull a --duration=<sec> argument out of argv (any position) so the
+// harnesses can keep their positional argument checks; returns 0 when the
+// run should stay iteration-bound.
+static inline double bench_parse_duration(int* argc, char** argv) {
+    double seconds = 0;
+    int out = 1;
+    for (int i = 1; i < *argc; i++) {
+        if (strncmp(argv[i], "--duration=", 11) == 0)
+            seconds = atof(argv[i] + 11);
+        else
+            argv[out++] = argv[i];
+    }
+    argv[out] = NULL;
+    *argc = out;
+    return seconds;
+}
+
+#endif // BENCH_STOP_H
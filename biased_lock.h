@@ -0,0 +1,192 @@
+#ifndef BIASED_LOCK_H
+#define BIASED_LOCK_H
+
+// Biased lock for thread-affine locks: the thread the lock is biased to
+// acquires and releases it with plain loads and stores, everybody else
+// goes through an inner futex mutex (futex_mutex.h) and first revokes the
+// bias.  The owner and the revoker synchronise as in an asymmetric Dekker
+// protocol (Dice, Moir & Scherer, "Quickly reacquirable locks"):
+//
+//   owner:    in[me] = 1;  load revoked    (only a compiler barrier between)
+//   revoker:  revoked = 1; membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED);
+//             wait until in[owner] == 0
+//
+// membarrier() runs a full barrier on every CPU running one of our
+// threads, so either the owner's flag is visible to the revoker or the
+// owner sees `revoked` and backs off to the inner mutex.  Each thread has
+// its own flag byte, so a thread that still thinks it is the owner after
+// the bias moved on can never clobber the new owner's flag.
+//
+// Bias policy, both tunable at run time:
+//   biased_bias_after     a thread that takes the unbiased lock this many
+//                         times in a row through the inner mutex gets the
+//                         bias
+//   biased_revoke_after   a biased lock survives this many revocations (each
+//                         foreign acquisition is one, the bias comes back
+//                         when it releases) before the bias is dropped
+// A thread gets a small id at its first acquisition and gives it back when
+// it exits; only BIASED_MAX_THREADS ids exist, threads beyond that always
+// take the inner mutex.  Without
+// MEMBARRIER_CMD_PRIVATE_EXPEDITED nobody ever gets the bias.
+//
+// Every thread counts its fast-path and inner-mutex acquisitions and its
+// revocations with their total time; lockbench sums and prints them.
+//
+// Not reentrant.  Plain C so the .c harnesses can include it as well.
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "futex_mutex.h"
+
+#ifndef BIASED_BIAS_AFTER
+#define BIASED_BIAS_AFTER 16
+#endif
+#ifndef BIASED_REVOKE_AFTER
+#define BIASED_REVOKE_AFTER 8
+#endif
+#define BIASED_MAX_THREADS 64      // ids are bits of one uint64_t
+
+static int biased_bias_after = BIASED_BIAS_AFTER;
+static int biased_revoke_after = BIASED_REVOKE_AFTER;
+static int biased_membarrier_ok = -1;  // -1 not registered yet
+
+static uint64_t biased_tids_used;
+static pthread_key_t biased_tid_key;
+static pthread_once_t biased_tid_once = PTHREAD_ONCE_INIT;
+static __thread int biased_tid = -1;
+static __thread uint64_t biased_fast_acquires;
+static __thread uint64_t biased_slow_acquires;
+static __thread uint64_t biased_revocations;
+static __thread uint64_t biased_revoke_ns;
+
+typedef struct {
+    int owner;                  // biased_tid holding the bias, -1 unbiased
+    int revoked;                // 1: the owner must use the inner mutex
+    int last;                   // inner-mutex acquirer streak, under `inner`
+    int streak;
+    int foreign;                // revocations since the bias was granted
+    futex_mutex_t inner;
+    unsigned char in[BIASED_MAX_THREADS] __attribute__((aligned(64)));
+} biased_lock_t;
+
+// Thread-exit destructor: the key holds biased_tid + 1
+static void biased_tid_release(void* v) {
+    __atomic_fetch_and(&biased_tids_used, ~(1ull << ((uintptr_t)v - 1)), __ATOMIC_RELEASE);
+}
+
+static void biased_tid_key_init(void) {
+    pthread_key_create(&biased_tid_key, biased_tid_release);
+}
+
+static void biased_claim_tid(void) {
+    uint64_t used = __atomic_load_n(&biased_tids_used, __ATOMIC_RELAXED);
+    biased_tid = BIASED_MAX_THREADS;
+    while (~used) {
+        int t = __builtin_ctzll(~used);
+        if (__atomic_compare_exchange_n(&biased_tids_used, &used, used | (1ull << t), 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            biased_tid = t;
+            pthread_once(&biased_tid_once, biased_tid_key_init);
+            pthread_setspecific(biased_tid_key, (void*)(uintptr_t)(t + 1));
+            return;
+        }
+    }
+}
+
+static inline int biased_self(void) {
+    if (biased_tid < 0)
+        biased_claim_tid();
+    return biased_tid;
+}
+
+static inline uint64_t biased_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline void biased_init(biased_lock_t* l) {
+    if (__atomic_load_n(&biased_membarrier_ok, __ATOMIC_ACQUIRE) < 0) {
+        int ok = syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+        if (!ok)
+            fprintf(stderr, "biased_lock.h: no MEMBARRIER_CMD_PRIVATE_EXPEDITED, locks stay unbiased\n");
+        __atomic_store_n(&biased_membarrier_ok, ok, __ATOMIC_RELEASE);
+    }
+    l->owner = -1;
+    l->revoked = 1;
+    l->last = -1;
+    l->streak = 0;
+    l->foreign = 0;
+    futex_mutex_init(&l->inner);
+    for (int i = 0; i < BIASED_MAX_THREADS; i++)
+        l->in[i] = 0;
+}
+
+static inline void biased_destroy(biased_lock_t* l) {
+    futex_mutex_destroy(&l->inner);
+}
+
+// Take the bias away from `owner`; called with the inner mutex held
+static inline void biased_revoke(biased_lock_t* l, int owner) {
+    uint64_t t0 = biased_now_ns();
+    __atomic_store_n(&l->revoked, 1, __ATOMIC_SEQ_CST);
+    syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+    int spins = 0;
+    while (__atomic_load_n(&l->in[owner], __ATOMIC_ACQUIRE))
+        ql_backoff(&spins);
+    if (++l->foreign >= biased_revoke_after) {
+        __atomic_store_n(&l->owner, -1, __ATOMIC_RELAXED);     // revoked stays set
+        l->foreign = 0;
+    }
+    biased_revocations++;
+    biased_revoke_ns += biased_now_ns() - t0;
+}
+
+static inline void biased_lock(biased_lock_t* l) {
+    int me = biased_self();
+    if (__atomic_load_n(&l->owner, __ATOMIC_RELAXED) == me) {
+        __atomic_store_n(&l->in[me], 1, __ATOMIC_RELAXED);
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);    // membarrier() does the rest
+        if (!__atomic_load_n(&l->revoked, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&l->owner, __ATOMIC_RELAXED) == me) {
+            biased_fast_acquires++;
+            return;
+        }
+        __atomic_store_n(&l->in[me], 0, __ATOMIC_RELEASE);
+    }
+    futex_mutex_lock(&l->inner);
+    biased_slow_acquires++;
+    if (l->owner >= 0 && l->owner != me)
+        biased_revoke(l, l->owner);
+    if (l->last == me) {
+        l->streak++;
+    } else {
+        l->last = me;
+        l->streak = 1;
+    }
+}
+
+static inline void biased_unlock(biased_lock_t* l) {
+    int me = biased_tid;
+    if (me < BIASED_MAX_THREADS && l->in[me]) {
+        __atomic_store_n(&l->in[me], 0, __ATOMIC_RELEASE);
+        return;
+    }
+    if (l->owner < 0) {
+        if (biased_membarrier_ok > 0 && me < BIASED_MAX_THREADS && l->streak >= biased_bias_after) {
+            __atomic_store_n(&l->owner, me, __ATOMIC_RELAXED);
+            l->foreign = 0;
+            __atomic_store_n(&l->revoked, 0, __ATOMIC_RELEASE);
+        }
+    } else if (l->owner != me) {
+        __atomic_store_n(&l->revoked, 0, __ATOMIC_RELEASE);    // bias back to the owner
+    }
+    futex_mutex_unlock(&l->inner);
+}
+
+#endif // BIASED_LOCK_H
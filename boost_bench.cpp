@@ -8,43 +8,38 @@
 #include <boost/thread/barrier.hpp>   // for boost::barrier
 #include <boost/chrono.hpp>
 #include <sched.h>
+#include "bench_stop.h"
+#include "placement.h"
+#include "perf_counters.h"
+#include "cpu_usage.h"
 
 // Use a descriptive name for the total workload
 #define TOTAL_ITERATIONS 100000000LL // Use LL for long long literal
 #define NUM_WARMUPITERATIONS 10000
 
-// CPU ranges
-#define CPU_RANGE1_START 0
-#define CPU_RANGE1_END 23
-#define CPU_RANGE2_START 48
-#define CPU_RANGE2_END 71
-
 #ifdef RECURSIVE
 boost::recursive_mutex mylock;
 #else
 boost::mutex mylock;
 #endif
 
+double run_seconds = 0;     // > 0: --duration=<sec> run instead of TOTAL_ITERATIONS
+std::vector<long long> ops_completed;
+std::vector<struct perf_group> perf_groups;    // one per thread, used with --perf
+std::vector<struct cpu_usage> cpu_usages;      // one per thread, used with --cpu
+
 // Global timing variables
 boost::chrono::high_resolution_clock::time_point timeStart, timeEnd;
 
-// Sets the CPU affinity for the current thread
+// Pin the calling thread according to --placement (placement.h)
 void set_cpu_affinity(int thread_index) {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-
-    // This logic correctly maps threads to two different CPU ranges
-    int cpu_id = (thread_index < 24) ? CPU_RANGE1_START + thread_index : CPU_RANGE2_START + (thread_index - 24);
-    CPU_SET(cpu_id, &cpuset);
-
-    if (sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) == -1) {
-        std::cerr << "Warning: Could not set CPU affinity for thread " << thread_index << std::endl;
-    }
+    placement_pin(thread_index);
 }
 
 // Combined function that does both warmup and measurement
 void combinedThreadFunction(int thread_index, long long iterations_per_thread, long long extra_iterations, boost::barrier& sync_barrier) {
     set_cpu_affinity(thread_index);
+    perf_group_open(&perf_groups[thread_index]);
 
     // Warmup phase - not timed
     for (long i = 0; i < NUM_WARMUPITERATIONS; i++) {
@@ -61,17 +56,25 @@ void combinedThreadFunction(int thread_index, long long iterations_per_thread, l
     // First thread to pass the barrier starts the timer
     if (thread_index == 0) {
         timeStart = boost::chrono::high_resolution_clock::now();
+        if (run_seconds > 0)
+            bench_stop_start(run_seconds);
     }
+    perf_group_start(&perf_groups[thread_index]);
+    cpu_usage_start(&cpu_usages[thread_index]);
 
     // Measurement phase - this will be timed
     long long total_iterations_for_this_thread = iterations_per_thread + (thread_index == 0 ? extra_iterations : 0);
-    for (long long i = 0; i < total_iterations_for_this_thread; i++) {
+    long long i;
+    for (i = 0; run_seconds > 0 ? !bench_should_stop() : i < total_iterations_for_this_thread; i++) {
 #ifdef RECURSIVE
         boost::lock_guard<boost::recursive_mutex> lock(mylock);
 #else
         boost::lock_guard<boost::mutex> lock(mylock);
 #endif
     }
+    perf_group_stop(&perf_groups[thread_index]);
+    cpu_usage_stop(&cpu_usages[thread_index]);
+    ops_completed[thread_index] = i;
     sync_barrier.wait();
     if (thread_index == 0) {
         timeEnd = boost::chrono::high_resolution_clock::now();
@@ -79,8 +82,12 @@ void combinedThreadFunction(int thread_index, long long iterations_per_thread, l
 }
 
 int main(int argc, char* argv[]) {
+    run_seconds = bench_parse_duration(&argc, argv);
+    placement_parse(&argc, argv);
+    perf_parse(&argc, argv);
+    cpu_usage_parse(&argc, argv);
     if (argc != 2) {
-        std::cout << "Usage: ./<exe> <num_threads>" << std::endl;
+        std::cout << "Usage: ./<exe> <num_threads> [--duration=<sec>] [--placement=<policy>] [--perf] [--cpu]" << std::endl;
         return 1;
     }
 
@@ -90,7 +97,11 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    placement_log(stderr, numWorkers);
     std::vector<boost::thread> Threads;
+    ops_completed.assign(numWorkers, 0);
+    perf_groups.resize(numWorkers);
+    cpu_usages.resize(numWorkers);
 
     // Calculate the number of iterations for each thread to perform.
     long long iterations_per_thread = TOTAL_ITERATIONS / numWorkers;
@@ -104,18 +115,24 @@ int main(int argc, char* argv[]) {
         Threads.emplace_back(combinedThreadFunction, i, iterations_per_thread, extra_iterations, boost::ref(sync_barrier));
     }
 
-    for (auto& th : Threads) {
-        th.join();
+    long long total_ops = 0;
+    for (int i = 0; i < numWorkers; i++) {
+        Threads[i].join();
+        total_ops += ops_completed[i];
     }
+    bench_stop_join();
 
     //timeEnd = boost::chrono::high_resolution_clock::now();
 
     double elapsed = boost::chrono::duration<double>(timeEnd - timeStart).count();
 
     // The throughput calculation now correctly reflects the total work done.
-    double throughput = static_cast<double>(TOTAL_ITERATIONS) / elapsed;
+    double throughput = static_cast<double>(total_ops) / elapsed;
 
-    std::cout << numWorkers << "," << elapsed << "," << throughput << std::endl;
+    std::cout << numWorkers << "," << elapsed << "," << throughput << std::flush;
+    perf_print_columns(stdout, perf_groups.data(), numWorkers, total_ops);
+    cpu_usage_print_columns(stdout, cpu_usages.data(), numWorkers, total_ops);
+    std::cout << std::endl;
 
     return 0;
 }
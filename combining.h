@@ -0,0 +1,136 @@
+#ifndef COMBINING_H
+#define COMBINING_H
+
+// Flat combining (Hendler, Incze, Shavit & Tzafrir) behind a closure API:
+// fc_execute(l, fn, arg) runs fn(arg) under the lock, but not necessarily
+// on the calling thread.
+//
+// Every thread that uses a lock owns one publication record in the lock's
+// publication list.  To run a critical section it posts fn/arg in its
+// record and raises `pending`; whichever thread gets the lock becomes the
+// combiner and runs every pending request of the list, FC_ROUNDS passes
+// over it, before letting go.  Everybody else just waits for its own
+// record to go quiet, so for short critical sections the protected data
+// stays in the combiner's cache instead of moving with the lock.
+//
+// Records are created on a thread's first call for a lock, found again
+// through a small per-thread table, and stay in the list until
+// fc_destroy() frees them all.  Results travel back through `arg`.
+//
+// Spin only, not reentrant: fn must not take the same lock again.
+//
+// Plain C so the .c harnesses can include it as well.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "queue_locks.h"        // ql_pause(), ql_backoff()
+
+#define FC_ROUNDS 2             // passes over the list per combining session
+#define FC_MAX_LOCKS 4          // combining locks one thread can use
+
+typedef void (*fc_fn)(void* arg);
+
+struct fc_record {
+    fc_fn fn;
+    void* arg;
+    int pending;                // 1 from posting until the combiner ran it
+    struct fc_record* next;
+} __attribute__((aligned(64)));
+
+typedef struct {
+    int lock;
+    unsigned id;                // tells a reused address from the lock it replaced
+    struct fc_record* head __attribute__((aligned(64)));   // publication list
+} fc_lock_t;
+
+static unsigned fc_next_id;
+
+static __thread struct {
+    fc_lock_t* lock;
+    unsigned id;
+    struct fc_record* rec;
+} fc_mine[FC_MAX_LOCKS];
+
+static inline void fc_init(fc_lock_t* l) {
+    l->lock = 0;
+    l->id = __atomic_add_fetch(&fc_next_id, 1, __ATOMIC_RELAXED);
+    l->head = NULL;
+}
+
+// Only once no thread uses the lock any more
+static inline void fc_destroy(fc_lock_t* l) {
+    struct fc_record* r = l->head;
+    while (r) {
+        struct fc_record* next = r->next;
+        free(r);
+        r = next;
+    }
+    l->head = NULL;
+}
+
+// The calling thread's record for l, published on first use
+static inline struct fc_record* fc_record_for(fc_lock_t* l) {
+    int k, free_slot = -1;
+    for (k = 0; k < FC_MAX_LOCKS; k++) {
+        if (fc_mine[k].lock == l) {
+            if (fc_mine[k].id == l->id)
+                return fc_mine[k].rec;
+            free_slot = k;      // left over from a destroyed lock at this address
+            break;
+        }
+        if (free_slot < 0 && !fc_mine[k].lock)
+            free_slot = k;
+    }
+    if (free_slot < 0) {
+        fprintf(stderr, "combining.h: more than %d flat-combining locks in one thread\n", FC_MAX_LOCKS);
+        exit(1);
+    }
+    struct fc_record* r = (struct fc_record*)aligned_alloc(64, sizeof(struct fc_record));
+    if (!r) {
+        perror("aligned_alloc");
+        exit(1);
+    }
+    r->pending = 0;
+    r->next = __atomic_load_n(&l->head, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&l->head, &r->next, r, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    fc_mine[free_slot].lock = l;
+    fc_mine[free_slot].id = l->id;
+    fc_mine[free_slot].rec = r;
+    return r;
+}
+
+static inline void fc_combine(fc_lock_t* l) {
+    for (int round = 0; round < FC_ROUNDS; round++) {
+        for (struct fc_record* r = __atomic_load_n(&l->head, __ATOMIC_ACQUIRE); r; r = r->next) {
+            if (__atomic_load_n(&r->pending, __ATOMIC_ACQUIRE)) {
+                r->fn(r->arg);
+                __atomic_store_n(&r->pending, 0, __ATOMIC_RELEASE);
+            }
+        }
+    }
+}
+
+static inline void fc_execute(fc_lock_t* l, fc_fn fn, void* arg) {
+    struct fc_record* rec = fc_record_for(l);
+    rec->fn = fn;
+    rec->arg = arg;
+    __atomic_store_n(&rec->pending, 1, __ATOMIC_RELEASE);
+    for (;;) {
+        if (!__atomic_load_n(&l->lock, __ATOMIC_RELAXED) &&
+            !__atomic_exchange_n(&l->lock, 1, __ATOMIC_ACQUIRE)) {
+            fc_combine(l);
+            __atomic_store_n(&l->lock, 0, __ATOMIC_RELEASE);
+        }
+        // wait for a combiner to serve us, or for the lock to come free
+        int spins = 0;
+        while (__atomic_load_n(&rec->pending, __ATOMIC_ACQUIRE) &&
+               __atomic_load_n(&l->lock, __ATOMIC_RELAXED))
+            ql_backoff(&spins);
+        if (!__atomic_load_n(&rec->pending, __ATOMIC_ACQUIRE))
+            return;
+    }
+}
+
+#endif // COMBINING_H
@@ -9,6 +9,11 @@
 #include <signal.h>
 #include <sched.h>
 #include <errno.h>
+#include "bench_stop.h"
+#include "placement.h"
+#include "perf_counters.h"
+#include "cpu_usage.h"
+#include "qlock_select.h"     // last: -DQLOCK_* swaps pthread_mutex_t for a queue lock
 
 #define TOTAL_LOCKS 4000         
 #define HIERARCHY_LEVELS 1000    
@@ -41,12 +46,6 @@ typedef struct {
 } thread_args_t;
 */
 
-// Enhanced CPU ranges for more thread distribution
-#define CPU_RANGE1_START 0
-#define CPU_RANGE1_END 47
-#define CPU_RANGE2_START 48
-#define CPU_RANGE2_END 95
-
 volatile sig_atomic_t keep_running = 1;
 
 typedef struct {
@@ -62,11 +61,14 @@ typedef struct {
     int work_amount;
     lock_group_t* lock_hierarchy;
     uint64_t* ops_completed;
+    struct perf_group* perf;    // This thread's counters (--perf)
+    struct cpu_usage* cpu;     // This thread's CPU time (--cpu)
     int is_warmup;
     uint64_t thread_seed;
 } thread_args_t;
 
 uint64_t total_operations = 0;
+double run_seconds = 0;     // > 0: --duration=<sec> run instead of NUM_ITERATIONS
 lock_group_t lock_hierarchy[HIERARCHY_LEVELS];
 uint64_t global_time = 0;
 
@@ -146,23 +148,9 @@ void cleanup_lock_hierarchy() {
     }
 }
 
-// Get next CPU in the allowed ranges
-int get_next_cpu(int thread_id) {
-    if (thread_id < 24) {
-        return CPU_RANGE1_START + thread_id;
-    } else {
-        return CPU_RANGE2_START + (thread_id - 24);
-    }
-}
-
-// Set CPU affinity for the current thread
+// Pin the calling thread according to --placement (placement.h)
 void set_cpu_affinity(int thread_id) {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    int cpu = get_next_cpu(thread_id);
-    CPU_SET(cpu, &cpuset);
-    
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    placement_pin(thread_id);
 }
 /*void set_cpu_affinity(int thread_id) {
     cpu_set_t cpuset;
@@ -213,7 +201,14 @@ void* worker_thread(void* arg) {
     
     int iterations = args->is_warmup ? WARMUP_ITERATIONS : NUM_ITERATIONS;
     
-    for(int i = 0; i < iterations && keep_running; i++) {
+    int timed = !args->is_warmup && run_seconds > 0;
+    if (!args->is_warmup) {
+        perf_group_open(args->perf);
+        perf_group_start(args->perf);
+        cpu_usage_start(args->cpu);
+    }
+    
+    for(int i = 0; (timed ? !bench_should_stop() : i < iterations) && keep_running; i++) {
         int start_level = next_random(random_state) % (HIERARCHY_LEVELS - args->nesting_depth + 1);
         acquire_hierarchical_locks(args->lock_hierarchy, start_level, args->nesting_depth, random_state);
         do_work(args->work_amount);
@@ -221,6 +216,8 @@ void* worker_thread(void* arg) {
     }
     
     if (!args->is_warmup) {
+        perf_group_stop(args->perf);
+        cpu_usage_stop(args->cpu);
         args->ops_completed[args->thread_id] = local_ops;
     }
     return NULL;
@@ -255,6 +252,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     pthread_t threads[MAX_THREADS];
     thread_args_t thread_args[MAX_THREADS];
     uint64_t ops_completed[MAX_THREADS] = {0};
+    struct perf_group perf[MAX_THREADS];
+    struct cpu_usage cpu_use[MAX_THREADS];
     uint64_t base_seed = 67890;
     
     if (init_lock_hierarchy() != 0) {
@@ -266,6 +265,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     
     struct timespec start, end;
     clock_gettime(CLOCK_MONOTONIC, &start);
+    if (run_seconds > 0)
+        bench_stop_start(run_seconds);
     
     for(int i = 0; i < num_threads; i++) {
         thread_args[i].thread_id = i;
@@ -274,6 +275,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
         thread_args[i].work_amount = work_amount;
         thread_args[i].lock_hierarchy = lock_hierarchy;
         thread_args[i].ops_completed = ops_completed;
+        thread_args[i].perf = &perf[i];
+        thread_args[i].cpu = &cpu_use[i];
         thread_args[i].is_warmup = 0;
         thread_args[i].thread_seed = base_seed + i;
         
@@ -290,18 +293,27 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     }
     
     clock_gettime(CLOCK_MONOTONIC, &end);
+    bench_stop_join();
     double duration = (end.tv_sec - start.tv_sec) + 
                      (end.tv_nsec - start.tv_nsec) / 1e9;
     
-    printf("%d,%d,%d,%.2f,%.2f\n", num_threads, nesting_depth, work_amount, 
+    printf("%d,%d,%d,%.2f,%.2f", num_threads, nesting_depth, work_amount, 
            duration, total_operations / duration);
+    perf_print_columns(stdout, perf, num_threads, total_operations);
+    cpu_usage_print_columns(stdout, cpu_use, num_threads, total_operations);
+    printf("\n");
     
     cleanup_lock_hierarchy();
 }
 
 int main(int argc, char* argv[]) {
+    run_seconds = bench_parse_duration(&argc, argv);
+    perf_parse(&argc, argv);
+    cpu_usage_parse(&argc, argv);
+    qlock_parse(&argc, argv);
+    placement_parse(&argc, argv);
     if(argc != 4) {
-        printf("Usage: %s <num_threads> <nesting_depth> <work_amount>\n", argv[0]);
+        printf("Usage: %s <num_threads> <nesting_depth> <work_amount> [--duration=<sec>] [--placement=<policy>] [--perf] [--cpu]\n", argv[0]);
         exit(1);
     }
     
@@ -316,6 +328,7 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
+    placement_log(stderr, thread_counts);
     run_benchmark(thread_counts, nesting_depths, work_amounts);
     
     return 0;
@@ -8,6 +8,10 @@
 #include <stdint.h>
 #include <signal.h>
 #include <sched.h>
+#include "bench_stop.h"
+#include "perf_counters.h"
+#include "cpu_usage.h"
+#include "qlock_select.h"     // last: -DQLOCK_* swaps pthread_mutex_t for a queue lock
 
 #define TOTAL_LOCKS 2000
 #define HIERARCHY_LEVELS 40
@@ -40,12 +44,15 @@ typedef struct {
     int work_amount;
     lock_group_t* lock_hierarchy;
     uint64_t* ops_completed;
+    struct perf_group* perf;    // This thread's counters (--perf)
+    struct cpu_usage* cpu;     // This thread's CPU time (--cpu)
     int is_warmup;
     uint64_t thread_seed;  // Per-thread random seed
 } thread_args_t;
 
 // Global variables
 uint64_t total_operations = 0;
+double run_seconds = 0;     // > 0: --duration=<sec> run instead of NUM_ITERATIONS
 lock_group_t lock_hierarchy[HIERARCHY_LEVELS];
 uint64_t global_time = 0;
 
@@ -157,14 +164,26 @@ void* worker_thread(void* arg) {
     uint64_t random_state[4];
     
     // Set CPU affinity
+#if defined(QLOCK_CBOMCS) || defined(QLOCK_HMCS)
+    // the cohort locks take the node from the CPU of the first acquisition
+    placement_pin(args->thread_id);
+#else
     //set_cpu_affinity(args->thread_id);
+#endif
     
     // Initialize thread-local random state
     init_random_state(random_state, args->thread_seed);
     
     int iterations = args->is_warmup ? WARMUP_ITERATIONS : NUM_ITERATIONS;
     
-    for(int i = 0; i < iterations && keep_running; i++) {
+    int timed = !args->is_warmup && run_seconds > 0;
+    if (!args->is_warmup) {
+        perf_group_open(args->perf);
+        perf_group_start(args->perf);
+        cpu_usage_start(args->cpu);
+    }
+    
+    for(int i = 0; (timed ? !bench_should_stop() : i < iterations) && keep_running; i++) {
         int start_level = next_random(random_state) % (HIERARCHY_LEVELS - args->nesting_depth + 1);
         acquire_hierarchical_locks(args->lock_hierarchy, start_level, args->nesting_depth, random_state);
         //do_work(args->work_amount);
@@ -172,6 +191,9 @@ void* worker_thread(void* arg) {
     }
     
     if (!args->is_warmup) {
+        perf_group_stop(args->perf);
+        cpu_usage_stop(args->cpu);
+        qlock_handoffs_collect();
         args->ops_completed[args->thread_id] = local_ops;
     }
     return NULL;
@@ -210,6 +232,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     pthread_t* threads = malloc(sizeof(pthread_t) * num_threads);
     thread_args_t* thread_args = malloc(sizeof(thread_args_t) * num_threads);
     uint64_t* ops_completed = calloc(num_threads, sizeof(uint64_t));
+    struct perf_group* perf = calloc(num_threads, sizeof(struct perf_group));
+    struct cpu_usage* cpu_use = calloc(num_threads, sizeof(struct cpu_usage));
     uint64_t base_seed = 67890;
     
     init_lock_hierarchy();
@@ -219,6 +243,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     
     struct timespec start, end;
     clock_gettime(CLOCK_MONOTONIC, &start);
+    if (run_seconds > 0)
+        bench_stop_start(run_seconds);
     
     for(int i = 0; i < num_threads; i++) {
         thread_args[i].thread_id = i;
@@ -227,6 +253,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
         thread_args[i].work_amount = work_amount;
         thread_args[i].lock_hierarchy = lock_hierarchy;
         thread_args[i].ops_completed = ops_completed;
+        thread_args[i].perf = &perf[i];
+        thread_args[i].cpu = &cpu_use[i];
         thread_args[i].is_warmup = 0;
         thread_args[i].thread_seed = base_seed + i;
         
@@ -239,6 +267,7 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     }
     
     clock_gettime(CLOCK_MONOTONIC, &end);
+    bench_stop_join();
     double duration = (end.tv_sec - start.tv_sec) + 
                      (end.tv_nsec - start.tv_nsec) / 1e9;
     
@@ -259,16 +288,29 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     printf("- Average latency: %.2f microseconds\n", 
            (duration * 1000000) / total_operations);
 */    
-    printf("%d,%d,%d,%.2f,%.2f\n",num_threads, nesting_depth, work_amount,duration,total_operations / duration);
+    printf("%d,%d,%d,%.2f,%.2f",num_threads, nesting_depth, work_amount,duration,total_operations / duration);
+    perf_print_columns(stdout, perf, num_threads, total_operations);
+    cpu_usage_print_columns(stdout, cpu_use, num_threads, total_operations);
+    qlock_handoffs_print_columns(stdout);
+    printf("\n");
     cleanup_lock_hierarchy();
     free(threads);
     free(thread_args);
     free(ops_completed);
+    free(perf);
+    free(cpu_use);
 }
 
 int main(int argc, char* argv[]) {
+    run_seconds = bench_parse_duration(&argc, argv);
+    perf_parse(&argc, argv);
+    cpu_usage_parse(&argc, argv);
+    qlock_parse(&argc, argv);
+#if defined(QLOCK_CBOMCS) || defined(QLOCK_HMCS)
+    placement_parse(&argc, argv);
+#endif
     if(argc != 4) {
-        printf("Usage: %s <num_threads> <nesting_depth> <work_amount>\n", argv[0]);
+        printf("Usage: %s <num_threads> <nesting_depth> <work_amount> [--duration=<sec>] [--perf] [--cpu]\n", argv[0]);
         exit(1);
     }
     
@@ -287,6 +329,9 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
+#if defined(QLOCK_CBOMCS) || defined(QLOCK_HMCS)
+    placement_log(stderr, thread_counts);
+#endif
     run_benchmark(thread_counts, nesting_depths, work_amounts);
     
     return 0;
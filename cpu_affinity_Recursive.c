@@ -8,6 +8,11 @@
 #include <stdint.h>
 #include <signal.h>
 #include <sched.h>
+#include "bench_stop.h"
+#include "placement.h"
+#include "perf_counters.h"
+#include "cpu_usage.h"
+#include "qlock_select.h"     // last: -DQLOCK_* swaps pthread_mutex_t for a queue lock
 
 #define TOTAL_LOCKS 2000
 #define HIERARCHY_LEVELS 1000
@@ -16,12 +21,6 @@
 #define WARMUP_ITERATIONS 10000
 #define NUM_CPUS 128
 
-// CPU ranges
-#define CPU_RANGE1_START 0
-#define CPU_RANGE1_END 63
-#define CPU_RANGE2_START 128
-#define CPU_RANGE2_END 191
-
 // Volatile flag for graceful termination
 volatile sig_atomic_t keep_running = 1;
 
@@ -40,12 +39,15 @@ typedef struct {
     int work_amount;
     lock_group_t* lock_hierarchy;
     uint64_t* ops_completed;
+    struct perf_group* perf;    // This thread's counters (--perf)
+    struct cpu_usage* cpu;     // This thread's CPU time (--cpu)
     int is_warmup;
     uint64_t thread_seed;  // Per-thread random seed
 } thread_args_t;
 
 // Global variables
 uint64_t total_operations = 0;
+double run_seconds = 0;     // > 0: --duration=<sec> run instead of NUM_ITERATIONS
 lock_group_t lock_hierarchy[HIERARCHY_LEVELS];
 uint64_t global_time = 0;
 
@@ -109,23 +111,9 @@ void cleanup_lock_hierarchy() {
     }
 }
 
-// Get next CPU in the allowed ranges
-int get_next_cpu(int thread_id) {
-    if (thread_id < 24) {
-        return CPU_RANGE1_START + thread_id;
-    } else {
-        return CPU_RANGE2_START + (thread_id - 24);
-    }
-}
-
-// Set CPU affinity for the current thread
+// Pin the calling thread according to --placement (placement.h)
 void set_cpu_affinity(int thread_id) {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    int cpu = get_next_cpu(thread_id);
-    CPU_SET(cpu, &cpuset);
-    
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    placement_pin(thread_id);
 }
 /*void set_cpu_affinity(int thread_id) {
     cpu_set_t cpuset;
@@ -164,7 +152,14 @@ void* worker_thread(void* arg) {
     
     int iterations = args->is_warmup ? WARMUP_ITERATIONS : NUM_ITERATIONS;
     
-    for(int i = 0; i < iterations && keep_running; i++) {
+    int timed = !args->is_warmup && run_seconds > 0;
+    if (!args->is_warmup) {
+        perf_group_open(args->perf);
+        perf_group_start(args->perf);
+        cpu_usage_start(args->cpu);
+    }
+    
+    for(int i = 0; (timed ? !bench_should_stop() : i < iterations) && keep_running; i++) {
         int start_level = next_random(random_state) % (HIERARCHY_LEVELS - args->nesting_depth + 1);
         acquire_hierarchical_locks(args->lock_hierarchy, start_level, args->nesting_depth, random_state);
         do_work(args->work_amount);
@@ -172,6 +167,8 @@ void* worker_thread(void* arg) {
     }
     
     if (!args->is_warmup) {
+        perf_group_stop(args->perf);
+        cpu_usage_stop(args->cpu);
         args->ops_completed[args->thread_id] = local_ops;
     }
     return NULL;
@@ -210,6 +207,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     pthread_t* threads = malloc(sizeof(pthread_t) * num_threads);
     thread_args_t* thread_args = malloc(sizeof(thread_args_t) * num_threads);
     uint64_t* ops_completed = calloc(num_threads, sizeof(uint64_t));
+    struct perf_group* perf = calloc(num_threads, sizeof(struct perf_group));
+    struct cpu_usage* cpu_use = calloc(num_threads, sizeof(struct cpu_usage));
     uint64_t base_seed = 67890;
     
     init_lock_hierarchy();
@@ -219,6 +218,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     
     struct timespec start, end;
     clock_gettime(CLOCK_MONOTONIC, &start);
+    if (run_seconds > 0)
+        bench_stop_start(run_seconds);
     
     for(int i = 0; i < num_threads; i++) {
         thread_args[i].thread_id = i;
@@ -227,6 +228,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
         thread_args[i].work_amount = work_amount;
         thread_args[i].lock_hierarchy = lock_hierarchy;
         thread_args[i].ops_completed = ops_completed;
+        thread_args[i].perf = &perf[i];
+        thread_args[i].cpu = &cpu_use[i];
         thread_args[i].is_warmup = 0;
         thread_args[i].thread_seed = base_seed + i;
         
@@ -239,6 +242,7 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     }
     
     clock_gettime(CLOCK_MONOTONIC, &end);
+    bench_stop_join();
     double duration = (end.tv_sec - start.tv_sec) + 
                      (end.tv_nsec - start.tv_nsec) / 1e9;
     
@@ -259,16 +263,26 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     printf("- Average latency: %.2f microseconds\n", 
            (duration * 1000000) / total_operations);
 */    
-    printf("%d,%d,%d,%.2f,%.2f\n",num_threads, nesting_depth, work_amount,duration,total_operations / duration);
+    printf("%d,%d,%d,%.2f,%.2f",num_threads, nesting_depth, work_amount,duration,total_operations / duration);
+    perf_print_columns(stdout, perf, num_threads, total_operations);
+    cpu_usage_print_columns(stdout, cpu_use, num_threads, total_operations);
+    printf("\n");
     cleanup_lock_hierarchy();
     free(threads);
     free(thread_args);
     free(ops_completed);
+    free(perf);
+    free(cpu_use);
 }
 
 int main(int argc, char* argv[]) {
+    run_seconds = bench_parse_duration(&argc, argv);
+    perf_parse(&argc, argv);
+    cpu_usage_parse(&argc, argv);
+    qlock_parse(&argc, argv);
+    placement_parse(&argc, argv);
     if(argc != 4) {
-        printf("Usage: %s <num_threads> <nesting_depth> <work_amount>\n", argv[0]);
+        printf("Usage: %s <num_threads> <nesting_depth> <work_amount> [--duration=<sec>] [--placement=<policy>] [--perf] [--cpu]\n", argv[0]);
         exit(1);
     }
     
@@ -287,6 +301,7 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
+    placement_log(stderr, thread_counts);
     run_benchmark(thread_counts, nesting_depths, work_amounts);
     
     return 0;
@@ -0,0 +1,93 @@
+#ifndef CPU_USAGE_H
+#define CPU_USAGE_H
+
+// Per-thread CPU cost of the timed phase (--cpu), so a lock that wins on
+// wall-clock throughput by keeping every core spinning shows what it paid.
+//
+// Each worker samples CLOCK_THREAD_CPUTIME_ID and getrusage(RUSAGE_THREAD)
+// when it is released and again when it leaves the timed loop.  The
+// harnesses append
+//   cpu_seconds,ops_per_cpu_sec,kernel_share,vol_csw,invol_csw
+// summed over all threads: kernel_share is system time over user + system
+// time (for these benchmarks that is almost all futex), vol_csw counts
+// blocking in the kernel, invol_csw preemptions.
+//
+// Everything is a no-op unless cpu_usage_parse() saw --cpu, so the
+// harnesses call these unconditionally.  Needs _GNU_SOURCE for
+// RUSAGE_THREAD.
+//
+// Plain C so the .c harnesses can include it as well.
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+struct cpu_usage {
+    struct timespec start;      // CLOCK_THREAD_CPUTIME_ID when released
+    struct rusage ru_start;
+    double cpu_sec;             // thread CPU time of the timed phase
+    double user_sec;
+    double sys_sec;
+    long vol_csw;
+    long invol_csw;
+};
+
+static int cpu_usage_enabled;
+
+static inline double cpu_usage_tv(struct timeval tv) {
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static inline void cpu_usage_start(struct cpu_usage* u) {
+    if (!cpu_usage_enabled)
+        return;
+    getrusage(RUSAGE_THREAD, &u->ru_start);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &u->start);
+}
+
+static inline void cpu_usage_stop(struct cpu_usage* u) {
+    struct timespec end;
+    struct rusage ru;
+    if (!cpu_usage_enabled)
+        return;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+    getrusage(RUSAGE_THREAD, &ru);
+    u->cpu_sec = (end.tv_sec - u->start.tv_sec) + (end.tv_nsec - u->start.tv_nsec) / 1e9;
+    u->user_sec = cpu_usage_tv(ru.ru_utime) - cpu_usage_tv(u->ru_start.ru_utime);
+    u->sys_sec = cpu_usage_tv(ru.ru_stime) - cpu_usage_tv(u->ru_start.ru_stime);
+    u->vol_csw = ru.ru_nvcsw - u->ru_start.ru_nvcsw;
+    u->invol_csw = ru.ru_nivcsw - u->ru_start.ru_nivcsw;
+}
+
+// Append the columns for `threads` workers that completed `ops` operations
+static void cpu_usage_print_columns(FILE* out, const struct cpu_usage* u, int threads, double ops) {
+    double cpu = 0, user = 0, sys = 0;
+    long vol = 0, invol = 0;
+    if (!cpu_usage_enabled)
+        return;
+    for (int t = 0; t < threads; t++) {
+        cpu += u[t].cpu_sec;
+        user += u[t].user_sec;
+        sys += u[t].sys_sec;
+        vol += u[t].vol_csw;
+        invol += u[t].invol_csw;
+    }
+    fprintf(out, ",%f,%f,%f,%ld,%ld", cpu, cpu > 0 ? ops / cpu : 0.0,
+            user + sys > 0 ? sys / (user + sys) : 0.0, vol, invol);
+}
+
+// Pull --cpu out of argv (any position)
+static inline void cpu_usage_parse(int* argc, char** argv) {
+    int out = 1;
+    for (int i = 1; i < *argc; i++) {
+        if (strcmp(argv[i], "--cpu") == 0)
+            cpu_usage_enabled = 1;
+        else
+            argv[out++] = argv[i];
+    }
+    argv[out] = NULL;
+    *argc = out;
+}
+
+#endif // CPU_USAGE_H
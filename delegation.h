@@ -0,0 +1,156 @@
+#ifndef DELEGATION_H
+#define DELEGATION_H
+
+// Delegation lock in the style of remote core locking (Lozi et al.) and
+// ffwd (Roghanchi, Eriksson & Basu): a dedicated server thread owns the
+// protected data and runs every critical section itself, so the data
+// never leaves the server's cache.
+//
+// Each client thread gets its own cache-line request slot on first use.
+// dlg_execute(l, fn, arg) writes fn/arg into the slot, raises `pending`
+// and waits; the server sweeps all slots, runs each pending fn(arg) and
+// writes the response back by clearing `pending` (results travel back
+// through `arg`).  Clients only ever touch their own line and the server
+// only the lines of clients with a request outstanding.
+//
+// The server is started by dlg_init(), pinned to `server_cpu` (-1 leaves
+// it to the scheduler), and stopped by dlg_destroy() once no client uses
+// the lock any more.  When it finds nothing to do for a while it yields,
+// and waiting clients do the same, so it also runs oversubscribed.
+//
+// fn runs on the server thread: it must not take the same lock again or
+// rely on thread-local state.
+//
+// Plain C so the .c harnesses can include it as well; needs _GNU_SOURCE.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "queue_locks.h"        // ql_pause(), ql_backoff()
+
+#define DLG_MAX_CLIENTS 1024    // client threads per lock
+#define DLG_MAX_LOCKS 4         // delegation locks one thread can use
+
+typedef void (*dlg_fn)(void* arg);
+
+struct dlg_slot {
+    dlg_fn fn;
+    void* arg;
+    int pending;                // 1 from the request until the server answered
+} __attribute__((aligned(64)));
+
+typedef struct {
+    struct dlg_slot* slots;     // DLG_MAX_CLIENTS of them
+    unsigned nclients;          // slots handed out so far
+    unsigned id;                // tells a reused address from the lock it replaced
+    int server_cpu;
+    int stop;
+    pthread_t server;
+} dlg_lock_t;
+
+static unsigned dlg_next_id;
+
+static __thread struct {
+    dlg_lock_t* lock;
+    unsigned id;
+    struct dlg_slot* slot;
+} dlg_mine[DLG_MAX_LOCKS];
+
+static void* dlg_server(void* arg) {
+    dlg_lock_t* l = (dlg_lock_t*)arg;
+    int idle = 0;
+    if (l->server_cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(l->server_cpu, &cpuset);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    }
+    while (!__atomic_load_n(&l->stop, __ATOMIC_ACQUIRE)) {
+        unsigned n = __atomic_load_n(&l->nclients, __ATOMIC_ACQUIRE);
+        int served = 0;
+        for (unsigned i = 0; i < n; i++) {
+            struct dlg_slot* s = &l->slots[i];
+            if (__atomic_load_n(&s->pending, __ATOMIC_ACQUIRE)) {
+                s->fn(s->arg);
+                __atomic_store_n(&s->pending, 0, __ATOMIC_RELEASE);
+                served = 1;
+            }
+        }
+        if (served)
+            idle = 0;
+        else
+            ql_backoff(&idle);
+    }
+    return NULL;
+}
+
+static inline void dlg_init(dlg_lock_t* l, int server_cpu) {
+    l->slots = (struct dlg_slot*)aligned_alloc(64, DLG_MAX_CLIENTS * sizeof(struct dlg_slot));
+    if (!l->slots) {
+        perror("aligned_alloc");
+        exit(1);
+    }
+    for (int i = 0; i < DLG_MAX_CLIENTS; i++)
+        l->slots[i].pending = 0;
+    l->nclients = 0;
+    l->id = __atomic_add_fetch(&dlg_next_id, 1, __ATOMIC_RELAXED);
+    l->server_cpu = server_cpu;
+    l->stop = 0;
+    if (pthread_create(&l->server, NULL, dlg_server, l) != 0) {
+        perror("pthread_create");
+        exit(1);
+    }
+}
+
+// Only once no thread uses the lock any more
+static inline void dlg_destroy(dlg_lock_t* l) {
+    __atomic_store_n(&l->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(l->server, NULL);
+    free(l->slots);
+    l->slots = NULL;
+}
+
+// The calling thread's request slot for l, claimed on first use
+static inline struct dlg_slot* dlg_slot_for(dlg_lock_t* l) {
+    int k, free_slot = -1;
+    for (k = 0; k < DLG_MAX_LOCKS; k++) {
+        if (dlg_mine[k].lock == l) {
+            if (dlg_mine[k].id == l->id)
+                return dlg_mine[k].slot;
+            free_slot = k;      // left over from a destroyed lock at this address
+            break;
+        }
+        if (free_slot < 0 && !dlg_mine[k].lock)
+            free_slot = k;
+    }
+    if (free_slot < 0) {
+        fprintf(stderr, "delegation.h: more than %d delegation locks in one thread\n", DLG_MAX_LOCKS);
+        exit(1);
+    }
+    // bounded claim: the server scans slots[0, nclients), so nclients
+    // must never pass DLG_MAX_CLIENTS
+    unsigned i = __atomic_load_n(&l->nclients, __ATOMIC_RELAXED);
+    do {
+        if (i >= DLG_MAX_CLIENTS) {
+            fprintf(stderr, "delegation.h: more than %d clients of one delegation lock\n", DLG_MAX_CLIENTS);
+            exit(1);
+        }
+    } while (!__atomic_compare_exchange_n(&l->nclients, &i, i + 1, 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    dlg_mine[free_slot].lock = l;
+    dlg_mine[free_slot].id = l->id;
+    dlg_mine[free_slot].slot = &l->slots[i];
+    return &l->slots[i];
+}
+
+static inline void dlg_execute(dlg_lock_t* l, dlg_fn fn, void* arg) {
+    struct dlg_slot* s = dlg_slot_for(l);
+    s->fn = fn;
+    s->arg = arg;
+    __atomic_store_n(&s->pending, 1, __ATOMIC_RELEASE);
+    int spins = 0;
+    while (__atomic_load_n(&s->pending, __ATOMIC_ACQUIRE))
+        ql_backoff(&spins);
+}
+
+#endif // DELEGATION_H
@@ -0,0 +1,37 @@
+#ifndef FAIRNESS_H
+#define FAIRNESS_H
+
+// Spread of per-thread operation counts from a fixed-duration run.
+// Jain's index is (sum x)^2 / (n * sum x^2): 1.0 when every thread got
+// the same share, 1/n when a single thread got everything.
+//
+// Plain C so the .c harnesses can include it as well.
+
+#include <stdint.h>
+
+struct fairness {
+    double jain;
+    double min_max;     // min_ops / max_ops
+    uint64_t min_ops;
+    uint64_t max_ops;
+};
+
+static inline struct fairness fairness_compute(const uint64_t* ops, int n) {
+    struct fairness f = { 0.0, 0.0, UINT64_MAX, 0 };
+    double sum = 0, sum_sq = 0;
+    for (int i = 0; i < n; i++) {
+        sum += (double)ops[i];
+        sum_sq += (double)ops[i] * (double)ops[i];
+        if (ops[i] < f.min_ops) f.min_ops = ops[i];
+        if (ops[i] > f.max_ops) f.max_ops = ops[i];
+    }
+    if (n > 0 && sum_sq > 0)
+        f.jain = sum * sum / (n * sum_sq);
+    if (f.max_ops > 0)
+        f.min_max = (double)f.min_ops / f.max_ops;
+    if (n == 0)
+        f.min_ops = 0;
+    return f;
+}
+
+#endif // FAIRNESS_H
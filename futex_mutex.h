@@ -0,0 +1,125 @@
+#ifndef FUTEX_MUTEX_H
+#define FUTEX_MUTEX_H
+
+// Minimal three-state futex mutex (Drepper, "Futexes Are Tricky", mutex
+// #3) straight on FUTEX_WAIT_PRIVATE / FUTEX_WAKE_PRIVATE, to tell how
+// much of pthread_mutex_t's cost is glibc and how much is the kernel.
+//
+//   state 0 unlocked, 1 locked, 2 locked and somebody may be asleep
+//
+// lock() tries one CAS 0 -> 1, then spins up to futex_mutex_spin times
+// retrying it, then swaps in 2 and sleeps until the swap returns 0.
+// unlock() swaps in 0 and only enters the kernel if the old value was 2.
+// Not reentrant.
+//
+// The policy is set at run time, for every futex mutex of the process:
+//   --futex-spin=<n>                 spins before sleeping (default
+//                                    FUTEX_MUTEX_SPIN, 0 sleeps at once)
+//   --futex-wake=one|all             wake one sleeper per unlock, or all
+//                                    of them (they race for the lock again)
+//   --futex-pause=pause|yield|none   what a spin does: PAUSE instruction,
+//                                    sched_yield(), or just re-read
+// futex_mutex_parse() pulls these out of argv.
+//
+// Plain C so the .c harnesses can include it as well.
+
+#include <limits.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "queue_locks.h"        // ql_pause(), ql_futex_wait(), ql_futex_wake()
+
+#ifndef FUTEX_MUTEX_SPIN
+#define FUTEX_MUTEX_SPIN 100    // glibc's adaptive mutex default
+#endif
+
+enum futex_pause { FUTEX_PAUSE_PAUSE, FUTEX_PAUSE_YIELD, FUTEX_PAUSE_NONE };
+
+static const char* const futex_pause_names[] = { "pause", "yield", "none" };
+
+static int futex_mutex_spin = FUTEX_MUTEX_SPIN;
+static int futex_mutex_wake_all = 0;
+static enum futex_pause futex_mutex_pause = FUTEX_PAUSE_PAUSE;
+
+typedef struct {
+    int state;
+} futex_mutex_t;
+
+static inline void futex_mutex_init(futex_mutex_t* m) {
+    m->state = 0;
+}
+
+static inline void futex_mutex_destroy(futex_mutex_t* m) {
+    (void)m;
+}
+
+static inline void futex_mutex_relax(void) {
+    if (futex_mutex_pause == FUTEX_PAUSE_PAUSE)
+        ql_pause();
+    else if (futex_mutex_pause == FUTEX_PAUSE_YIELD)
+        sched_yield();
+}
+
+static inline void futex_mutex_lock(futex_mutex_t* m) {
+    int c = 0;
+    if (__atomic_compare_exchange_n(&m->state, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return;
+    for (int i = 0; i < futex_mutex_spin; i++) {
+        futex_mutex_relax();
+        c = __atomic_load_n(&m->state, __ATOMIC_RELAXED);
+        if (c == 0 && __atomic_compare_exchange_n(&m->state, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return;
+    }
+    if (c != 2)
+        c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+    while (c != 0) {
+        ql_futex_wait(&m->state, 2);
+        c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+static inline void futex_mutex_unlock(futex_mutex_t* m) {
+    if (__atomic_exchange_n(&m->state, 0, __ATOMIC_RELEASE) == 2)
+        ql_futex_wake(&m->state, futex_mutex_wake_all ? INT_MAX : 1);
+}
+
+// Pull --futex-spin/--futex-wake/--futex-pause out of argv (any position);
+// exit with a message on a bad value.
+static inline void futex_mutex_parse(int* argc, char** argv) {
+    int out = 1;
+    for (int i = 1; i < *argc; i++) {
+        const char* a = argv[i];
+        if (strncmp(a, "--futex-spin=", 13) == 0) {
+            futex_mutex_spin = atoi(a + 13);
+            if (futex_mutex_spin < 0) {
+                fprintf(stderr, "Error: --futex-spin must be >= 0\n");
+                exit(1);
+            }
+        } else if (strncmp(a, "--futex-wake=", 13) == 0) {
+            if (strcmp(a + 13, "one") == 0) {
+                futex_mutex_wake_all = 0;
+            } else if (strcmp(a + 13, "all") == 0) {
+                futex_mutex_wake_all = 1;
+            } else {
+                fprintf(stderr, "Error: unknown --futex-wake '%s' (one, all)\n", a + 13);
+                exit(1);
+            }
+        } else if (strncmp(a, "--futex-pause=", 14) == 0) {
+            int k = 0;
+            while (k < 3 && strcmp(a + 14, futex_pause_names[k]) != 0)
+                k++;
+            if (k == 3) {
+                fprintf(stderr, "Error: unknown --futex-pause '%s' (pause, yield, none)\n", a + 14);
+                exit(1);
+            }
+            futex_mutex_pause = (enum futex_pause)k;
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argv[out] = NULL;
+    *argc = out;
+}
+
+#endif // FUTEX_MUTEX_H
@@ -0,0 +1,31 @@
+#!/bin/bash
+# Learned vs stock adaptive spinning on ../hierarchical_lock_benchmark.c.
+# Output columns: threads,nesting_depth,work_amount,seconds,ops/sec, then --cpu's
+# cpu_seconds,ops_per_cpu_sec,kernel_share,vol_csw,invol_csw
+date
+export glibc_install=/home/nikhil/glibc_install
+
+gcc \
+  -L "${glibc_install}/lib" \
+  -I "${glibc_install}/include" \
+  -Wl,--rpath="${glibc_install}/lib" \
+  -Wl,--dynamic-linker="${glibc_install}/lib/ld-linux-x86-64.so.2" \
+  -O3 \
+  -o hierarchical_benchmark_ls_adaptive \
+  ../hierarchical_lock_benchmark.c \
+  -lpthread -DADAPTIVE\
+;
+gcc -O3 -o hierarchical_benchmark_normal ../hierarchical_lock_benchmark.c -lpthread
+gcc -O3 -o hierarchical_benchmark_adaptive ../hierarchical_lock_benchmark.c -lpthread -DADAPTIVE
+
+for i in {1..10}
+	do
+	for work in 0 10 100 1000 10000
+		do
+		./hierarchical_benchmark_normal 64 4 $work --cpu >>results/hierarchical_normal.csv
+		./hierarchical_benchmark_adaptive 64 4 $work --cpu >>results/hierarchical_adaptive.csv
+		./hierarchical_benchmark_ls_adaptive 64 4 $work --cpu >>results/hierarchical_ls_adaptive.csv
+		LS_ADAPTIVE_SPIN=learned ./hierarchical_benchmark_ls_adaptive 64 4 $work --cpu >>results/hierarchical_ls_adaptive_learned.csv
+		done
+	done
+date
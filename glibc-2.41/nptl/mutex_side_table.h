@@ -0,0 +1,81 @@
+#ifndef MUTEX_SIDE_TABLE_H
+#define MUTEX_SIDE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic.h>
+
+// Open-addressing side table keyed by mutex address, shared by the
+// learned spin budget (mutex_spin_learn.c) and the contention statistics
+// (mutex_stats.c), so pthread_mutex_t keeps its ABI.  An entry is any
+// struct whose first member is `void* mutex` (NULL while the slot is
+// free); the table is an array of SLOTS (a power of two) of them, and a
+// mutex lives in one of the PROBES slots after its hash.
+//
+// A slot is claimed by CAS on first use and freed again by
+// pthread_mutex_destroy, which zeroes it first, so a mutex created later
+// at the same address starts from scratch.  Freed slots leave holes in
+// probe chains: lookups check every probe for the key before claiming.
+
+static inline unsigned int side_table_home (const void* mutex, unsigned int slots) {
+    uintptr_t h = ((uintptr_t)mutex >> 3) * 0x9e3779b97f4a7c15ULL;
+    return (h >> 32) & (slots - 1);
+}
+
+static inline void* side_table_slot (void* table, size_t size, unsigned int slots,
+                                     unsigned int home, int i) {
+    return (char*)table + ((home + i) & (slots - 1)) * size;
+}
+
+// MUTEX's entry, NULL if it has none
+static inline void* side_table_find (void* table, size_t size, unsigned int slots,
+                                     int probes, const void* mutex) {
+    unsigned int home = side_table_home(mutex, slots);
+    for (int i = 0; i < probes; i++) {
+        void** e = side_table_slot(table, size, slots, home, i);
+        if (atomic_load_relaxed(e) == mutex)
+            return e;
+    }
+    return NULL;
+}
+
+// MUTEX's entry, claiming a free slot for it if it has none; NULL when
+// all of its probes are taken
+static inline void* side_table_lookup (void* table, size_t size, unsigned int slots,
+                                       int probes, void* mutex) {
+    unsigned int home = side_table_home(mutex, slots);
+    void** free_slot = NULL;
+    for (int i = 0; i < probes; i++) {
+        void** e = side_table_slot(table, size, slots, home, i);
+        void* key = atomic_load_relaxed(e);
+        if (key == mutex)
+            return e;
+        if (key == NULL && free_slot == NULL)
+            free_slot = e;
+    }
+    if (free_slot == NULL)
+        return NULL;
+    void* key = atomic_compare_and_exchange_val_acq(free_slot, mutex, NULL);
+    return key == NULL || key == mutex ? free_slot : NULL;
+}
+
+// Zero MUTEX's entry and free its slot
+static inline void side_table_forget (void* table, size_t size, unsigned int slots,
+                                      int probes, const void* mutex) {
+    void** e = side_table_find(table, size, slots, probes, mutex);
+    if (e != NULL) {
+        memset(e + 1, 0, size - sizeof(void*));
+        atomic_store_release(e, NULL);
+    }
+}
+
+// Shorthands for a table declared as an array of entries
+#define SIDE_TABLE_FIND(table, probes, mutex) \
+    side_table_find(table, sizeof((table)[0]), sizeof(table) / sizeof((table)[0]), probes, mutex)
+#define SIDE_TABLE_LOOKUP(table, probes, mutex) \
+    side_table_lookup(table, sizeof((table)[0]), sizeof(table) / sizeof((table)[0]), probes, mutex)
+#define SIDE_TABLE_FORGET(table, probes, mutex) \
+    side_table_forget(table, sizeof((table)[0]), sizeof(table) / sizeof((table)[0]), probes, mutex)
+
+#endif // MUTEX_SIDE_TABLE_H
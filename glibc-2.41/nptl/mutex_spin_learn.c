@@ -0,0 +1,24 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mutex_spin_learn.h"
+#include "mutex_side_table.h"
+
+int __spin_learn_mode = -1;
+spin_learn_entry __spin_learn_table[SPIN_LEARN_SLOTS];
+
+int __spin_learn_init (void) {
+    const char* env = getenv("LS_ADAPTIVE_SPIN");
+    int mode = env != NULL && strcmp(env, "learned") == 0;
+    atomic_store_relaxed(&__spin_learn_mode, mode);
+    return mode;
+}
+
+spin_learn_entry* __spin_learn_lookup (void* mutex) {
+    return SIDE_TABLE_LOOKUP(__spin_learn_table, SPIN_LEARN_PROBES, mutex);
+}
+
+void __spin_learn_forget (void* mutex) {
+    if (atomic_load_relaxed(&__spin_learn_mode) <= 0)
+        return;
+    SIDE_TABLE_FORGET(__spin_learn_table, SPIN_LEARN_PROBES, mutex);
+}
@@ -0,0 +1,121 @@
+#ifndef MUTEX_SPIN_LEARN_H
+#define MUTEX_SPIN_LEARN_H
+
+#include <stdint.h>
+#include <atomic.h>
+#include <hp-timing.h>
+
+// Learned spin budget for PTHREAD_MUTEX_ADAPTIVE_NP mutexes.
+//
+// Enabled at run time with LS_ADAPTIVE_SPIN=learned; otherwise adaptive
+// mutexes use the stock exponential-backoff loop.  Per-mutex statistics
+// live in a side table keyed by mutex address (mutex_side_table.h) so
+// pthread_mutex_t keeps its ABI; pthread_mutex_destroy frees the slot
+// again.  All times are in TSC ticks (HP_TIMING_NOW).
+//
+// The owner records how long it holds the lock, and a waiter that had to
+// sleep records how long it took to run again after the holder's futex
+// wake.  A contended lock then spins only while that is cheaper than
+// sleeping: up to twice the typical hold time when hold times are short
+// and stable compared to the wake latency, and not at all on locks whose
+// holders keep them longer than a wake-up costs.
+
+#define SPIN_LEARN_SLOTS 4096        // power of two
+#define SPIN_LEARN_PROBES 8
+#define SPIN_LEARN_DEFAULT 2000      // budget before anything was observed
+#define SPIN_LEARN_MAX (1 << 16)
+
+typedef struct {
+    void* mutex;                 // key, NULL while the slot is free
+    hp_timing_t acquired_at;     // when the current owner got the lock
+    hp_timing_t released_at;     // last release that had sleeping waiters
+    uint32_t hold_avg;           // EWMA (1/8) of hold time
+    uint32_t hold_dev;           // EWMA of |hold - hold_avg|
+    uint32_t wake_avg;           // EWMA of futex wake -> waiter running
+    uint32_t spin_ok;            // EWMA of spin success, 0-256
+} __attribute__((aligned(64))) spin_learn_entry;
+
+extern int __spin_learn_mode attribute_hidden;   // -1 unknown, 0 stock, 1 learned
+extern spin_learn_entry __spin_learn_table[SPIN_LEARN_SLOTS] attribute_hidden;
+
+extern int __spin_learn_init (void) attribute_hidden;
+extern spin_learn_entry* __spin_learn_lookup (void* mutex) attribute_hidden;
+extern void __spin_learn_forget (void* mutex) attribute_hidden;
+
+// NULL when the learned mode is off or the side table is full; the caller
+// then uses the stock adaptive path.
+static inline spin_learn_entry* spin_learn_get(void* mutex) {
+#if HP_TIMING_AVAIL
+    int mode = atomic_load_relaxed(&__spin_learn_mode);
+    if (__glibc_unlikely(mode < 0))
+        mode = __spin_learn_init();
+    return mode ? __spin_learn_lookup(mutex) : NULL;
+#else
+    return NULL;
+#endif
+}
+
+static inline uint32_t spin_learn_ewma(uint32_t avg, uint64_t sample) {
+    if (sample > UINT32_MAX)
+        sample = UINT32_MAX;
+    return avg + ((int64_t)sample - (int64_t)avg) / 8;
+}
+
+// Spin budget for a waiter that just failed the trylock.
+static inline uint64_t spin_learn_budget(spin_learn_entry* e) {
+    uint32_t hold = atomic_load_relaxed(&e->hold_avg);
+    uint32_t dev = atomic_load_relaxed(&e->hold_dev);
+    uint32_t wake = atomic_load_relaxed(&e->wake_avg);
+    if (wake == 0)
+        return SPIN_LEARN_DEFAULT;
+    uint64_t expect = (uint64_t)hold + dev;
+    if (expect > wake)
+        return 0;
+    uint64_t budget = 2 * expect;
+    if (budget > SPIN_LEARN_MAX)
+        budget = SPIN_LEARN_MAX;
+    // Spinning keeps failing: the holder is probably descheduled.
+    if (atomic_load_relaxed(&e->spin_ok) < 64)
+        budget /= 4;
+    return budget;
+}
+
+// Called by the new owner at time NOW.  SLEPT_AT is when it gave up
+// spinning and went to the futex (0 if it never did); SPUN_OK is 1/0 for a
+// spin that succeeded/failed and -1 if there was no contention at all.
+static inline void spin_learn_acquired(spin_learn_entry* e, hp_timing_t now,
+                                       hp_timing_t slept_at, int spun_ok) {
+    if (slept_at != 0) {
+        // Only a release that happened while we slept woke us up.
+        hp_timing_t rel = atomic_load_relaxed(&e->released_at);
+        if (rel >= slept_at && now > rel)
+            atomic_store_relaxed(&e->wake_avg,
+                                 spin_learn_ewma(e->wake_avg, now - rel));
+    }
+    if (spun_ok >= 0)
+        atomic_store_relaxed(&e->spin_ok,
+                             spin_learn_ewma(e->spin_ok, spun_ok ? 256 : 0));
+    e->acquired_at = now;
+}
+
+// Called by the owner right before it unlocks.  Only holds that began in
+// lll_mutex_lock_learned have acquired_at set; trylock and timedlock do
+// not stamp it, so it is cleared on every release and a hold without it
+// is not recorded.
+static inline void spin_learn_release(spin_learn_entry* e, unsigned int lock) {
+    hp_timing_t now;
+    HP_TIMING_NOW(now);
+    if (e->acquired_at != 0) {
+        uint64_t hold = now - e->acquired_at;
+        uint32_t avg = e->hold_avg;
+        uint64_t dev = hold > avg ? hold - avg : avg - hold;
+        atomic_store_relaxed(&e->hold_dev, spin_learn_ewma(e->hold_dev, dev));
+        atomic_store_relaxed(&e->hold_avg, spin_learn_ewma(avg, hold));
+        e->acquired_at = 0;
+    }
+    // lll_lock value 2: somebody is (or is about to be) asleep on the futex.
+    if (lock > 1)
+        atomic_store_relaxed(&e->released_at, now);
+}
+
+#endif // MUTEX_SPIN_LEARN_H
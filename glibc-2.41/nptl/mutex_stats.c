@@ -0,0 +1,62 @@
+#include <errno.h>
+#include <atomic.h>
+#include "mutex_stats.h"
+#include "mutex_side_table.h"
+
+#if MUTEX_STATS
+mutex_stats_entry __mutex_stats_table[MUTEX_STATS_SLOTS];
+
+mutex_stats_entry* __mutex_stats_lookup (void* mutex) {
+    return SIDE_TABLE_LOOKUP(__mutex_stats_table, MUTEX_STATS_PROBES, mutex);
+}
+
+void __mutex_stats_forget (void* mutex) {
+    SIDE_TABLE_FORGET(__mutex_stats_table, MUTEX_STATS_PROBES, mutex);
+}
+
+static void copy_stats(const mutex_stats_entry* e, struct pthread_mutex_stats_np* out) {
+    out->mutex = e->mutex;
+    out->acquisitions = e->acquisitions;
+    out->contended = e->contended;
+    out->futex_waits = e->futex_waits;
+    out->wait_ns = e->wait_ns;
+    out->shield_skips = e->shield_skips;
+}
+#endif
+
+int pthread_mutex_getstats_np (const pthread_mutex_t* mutex,
+                               struct pthread_mutex_stats_np* stats) {
+#if MUTEX_STATS
+    const mutex_stats_entry* e = SIDE_TABLE_FIND(__mutex_stats_table, MUTEX_STATS_PROBES, mutex);
+    if (e != NULL) {
+        copy_stats(e, stats);
+        return 0;
+    }
+    return ENOENT;
+#else
+    return ENOSYS;
+#endif
+}
+
+int pthread_mutex_stats_top_np (struct pthread_mutex_stats_np* stats, int max) {
+#if MUTEX_STATS
+    int n = 0;
+    for (int i = 0; i < MUTEX_STATS_SLOTS; i++) {
+        const mutex_stats_entry* e = &__mutex_stats_table[i];
+        if (atomic_load_relaxed(&e->mutex) == NULL)
+            continue;
+        // insertion into the sorted prefix, dropping the least contended
+        int pos = n < max ? n++ : max;
+        while (pos > 0 && stats[pos - 1].contended < e->contended) {
+            if (pos < max)
+                stats[pos] = stats[pos - 1];
+            pos--;
+        }
+        if (pos < max)
+            copy_stats(e, &stats[pos]);
+    }
+    return n;
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,63 @@
+#ifndef MUTEX_STATS_H
+#define MUTEX_STATS_H
+
+#include <stdint.h>
+#include <time.h>
+#include "pthread_mutex_stats_np.h"
+
+// Opt-in contention statistics behind pthread_mutex_getstats_np.  Build
+// glibc with -DMUTEX_STATS=1 (or flip the default below) to collect them;
+// with 0 the hooks in pthread_mutex_lock.c are compiled out entirely.
+// Counters live in a side table keyed by mutex address (mutex_side_table.h)
+// so the pthread_mutex_t ABI is unchanged; pthread_mutex_destroy drops
+// the mutex's entry.  Every counter of an entry is updated only by the thread
+// that currently holds that mutex, so plain increments are enough.
+//
+// Contention (contended, futex_waits, wait_ns) is only counted on the
+// lll_lock path of normal, recursive, errorcheck and adaptive mutexes.
+// Robust, PI and PP mutexes go through __pthread_mutex_lock_full, which
+// has its own futex protocols; for them only acquisitions and shield
+// skips are recorded and the contention counters stay 0.
+#ifndef MUTEX_STATS
+#define MUTEX_STATS 0
+#endif
+
+#define MUTEX_STATS_SLOTS 4096       // power of two
+#define MUTEX_STATS_PROBES 8
+
+typedef struct {
+    void* mutex;                 // key, NULL while the slot is free
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t futex_waits;
+    uint64_t wait_ns;
+    uint64_t shield_skips;
+} __attribute__((aligned(64))) mutex_stats_entry;
+
+#if MUTEX_STATS
+extern mutex_stats_entry __mutex_stats_table[MUTEX_STATS_SLOTS] attribute_hidden;
+
+// NULL once the table is full; that mutex is then not recorded.
+extern mutex_stats_entry* __mutex_stats_lookup (void* mutex) attribute_hidden;
+extern void __mutex_stats_forget (void* mutex) attribute_hidden;
+
+static inline uint64_t mutex_stats_now(void) {
+    struct __timespec64 ts;
+    __clock_gettime64(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void mutex_stats_acquired(void* mutex) {
+    mutex_stats_entry* st = __mutex_stats_lookup(mutex);
+    if (st != NULL)
+        st->acquisitions++;
+}
+
+static inline void mutex_stats_shield_skip(void* mutex) {
+    mutex_stats_entry* st = __mutex_stats_lookup(mutex);
+    if (st != NULL)
+        st->shield_skips++;
+}
+#endif
+
+#endif // MUTEX_STATS_H
@@ -27,6 +27,8 @@
 #include <stap-probe.h>
 #include <shlib-compat.h>
 #include "shield_arr.h"
+#include "mutex_spin_learn.h"
+#include "mutex_stats.h"
 
 /* Some of the following definitions differ when pthread_mutex_cond_lock.c
    includes this file.  */
@@ -70,14 +72,123 @@ lll_mutex_lock_optimized (pthread_mutex_t *mutex)
   atomic_load_relaxed (&(mutex)->__data.__lock)
 #endif
 
+#if MUTEX_STATS && !defined NO_INCR
+/* lll_lock with contention accounting for pthread_mutex_getstats_np.  The
+   slow path is __lll_lock_wait, copied so that the futex waits can be
+   counted.  Counters are updated once we own the mutex.  */
+static void
+lll_mutex_lock_stats (pthread_mutex_t *mutex)
+{
+  int *futex = &mutex->__data.__lock;
+  if (__glibc_likely (atomic_compare_and_exchange_bool_acq (futex, 1, 0) == 0))
+    return;
+
+  uint64_t start = mutex_stats_now ();
+  uint64_t waits = 0;
+  int private = PTHREAD_MUTEX_PSHARED (mutex);
+  if (atomic_load_relaxed (futex) == 2)
+    goto futex;
+
+  while (atomic_exchange_acquire (futex, 2) != 0)
+    {
+    futex:
+      waits++;
+      futex_wait ((unsigned int *) futex, 2, private);
+    }
+
+  mutex_stats_entry *st = __mutex_stats_lookup (mutex);
+  if (st != NULL)
+    {
+      st->contended++;
+      st->futex_waits += waits;
+      st->wait_ns += mutex_stats_now () - start;
+    }
+}
+
+# undef LLL_MUTEX_LOCK
+# define LLL_MUTEX_LOCK(mutex) lll_mutex_lock_stats (mutex)
+# undef LLL_MUTEX_LOCK_OPTIMIZED
+# define LLL_MUTEX_LOCK_OPTIMIZED(mutex) lll_mutex_lock_stats (mutex)
+# define MUTEX_STATS_ACQUIRED(mutex) mutex_stats_acquired (mutex)
+# define MUTEX_STATS_SHIELD_SKIP(mutex) mutex_stats_shield_skip (mutex)
+#else
+# define MUTEX_STATS_ACQUIRED(mutex) ((void) 0)
+# define MUTEX_STATS_SHIELD_SKIP(mutex) ((void) 0)
+#endif
+
 static int LLL_MUTEX_LOCK_Wrapper(void* mutex){
-        LLL_MUTEX_LOCK((pthread_mutex_t *)mutex);
+        pthread_mutex_t *m = (pthread_mutex_t *)mutex;
+        /* Mutexes that did not fit in the shield table are owned through
+           __owner; do not deadlock on a nested acquisition of one.  */
+        if (__glibc_unlikely (m->__data.__owner
+                              == THREAD_GETMEM (THREAD_SELF, tid)))
+          return 1;
+        LLL_MUTEX_LOCK(m);
+        MUTEX_STATS_ACQUIRED (m);
         return 0;
 }
 
 static int __pthread_mutex_lock_full (pthread_mutex_t *mutex)
      __attribute_noinline__;
 
+#if HP_TIMING_AVAIL
+/* Adaptive mutex with a learned spin budget, see mutex_spin_learn.h.
+   Spins for at most spin_learn_budget ticks, then blocks.  */
+static void
+lll_mutex_lock_learned (pthread_mutex_t *mutex, spin_learn_entry *learn)
+{
+  hp_timing_t start, now, slept_at = 0;
+  int spun_ok = -1;
+
+  if (LLL_MUTEX_TRYLOCK (mutex) != 0)
+    {
+      uint64_t budget = spin_learn_budget (learn);
+      HP_TIMING_NOW (start);
+      spun_ok = 1;
+      do
+	{
+	  HP_TIMING_NOW (now);
+	  if (now - start >= budget)
+	    {
+	      slept_at = now;
+	      spun_ok = budget != 0 ? 0 : -1;
+	      LLL_MUTEX_LOCK (mutex);
+	      break;
+	    }
+	  atomic_spin_nop ();
+	}
+      while (LLL_MUTEX_READ_LOCK (mutex) != 0
+	     || LLL_MUTEX_TRYLOCK (mutex) != 0);
+    }
+  HP_TIMING_NOW (now);
+  spin_learn_acquired (learn, now, slept_at, spun_ok);
+}
+#endif
+
+/* Robust and PI recursive mutexes.  Only the outermost acquisition goes
+   through __pthread_mutex_lock_full, which does the robust-list
+   bookkeeping and FUTEX_LOCK_PI; nested ones are counted in the shield
+   table and leave __count at 1, the robust list and the kernel PI state
+   untouched.  If the table is full the mutex is not shielded and nested
+   calls take the stock path that bumps __count.  */
+static int
+__pthread_mutex_lock_full_shield (pthread_mutex_t *mutex)
+{
+  LS_LockEntry *entry = lookup (mutex);
+  if (entry != NULL)
+    {
+      entry->rec_count++;
+      MUTEX_STATS_SHIELD_SKIP (mutex);
+      return 0;
+    }
+
+  int retval = __pthread_mutex_lock_full (mutex);
+  /* EOWNERDEAD means we got the mutex too.  */
+  if (retval == 0 || retval == EOWNERDEAD)
+    IncrementRef (mutex);
+  return retval;
+}
+
 int
 PTHREAD_MUTEX_LOCK (pthread_mutex_t *mutex)
 {
@@ -87,15 +198,35 @@ PTHREAD_MUTEX_LOCK (pthread_mutex_t *mutex)
 #if 1
   if (__builtin_expect (type == PTHREAD_MUTEX_RECURSIVE_NP, 0)){
     //mutex->__data.__kind = PTHREAD_MUTEX_NORMAL;
-    LS_ACQUIRE1(mutex, true, LLL_MUTEX_LOCK_Wrapper);
-    //++mutex->__data.__count;
+    LS_Status status = LS_ACQUIRE1(mutex, true, LLL_MUTEX_LOCK_Wrapper);
+    if (status == LS_SKIP_ACQUISITION)
+      MUTEX_STATS_SHIELD_SKIP (mutex);
+    else if (__glibc_unlikely (status == LS_OVERFLOW_HELD))
+      {
+	/* Overflowed mutex we already own: just bump the counter.  */
+	if (__glibc_unlikely (mutex->__data.__count + 1 == 0))
+	  /* Overflow of the counter.  */
+	  return EAGAIN;
+
+	++mutex->__data.__count;
+      }
+    else if (__glibc_unlikely (status == LS_OVERFLOW_ACQUIRE))
+      {
+	/* The shield table is full.  Record the ownership the way the
+	   stock recursive mutex does so that nested calls and the unlock
+	   path can find it.  */
+	mutex->__data.__owner = THREAD_GETMEM (THREAD_SELF, tid);
+	mutex->__data.__count = 1;
+      }
     return 0;
   }
   else if(__builtin_expect (type == PTHREAD_MUTEX_ERRORCHECK, 0)){
         //mutex->__data.__kind = PTHREAD_MUTEX_NORMAL;
         LS_Status status = LS_ACQUIRE1(mutex, false, LLL_MUTEX_LOCK_Wrapper);
-    	if(status == LS_UNBALANCED_LOCK)
+    	if(status == LS_UNBALANCED_LOCK || status == LS_OVERFLOW_HELD)
             return EDEADLK;
+        if (__glibc_unlikely (status == LS_OVERFLOW_ACQUIRE))
+          mutex->__data.__owner = THREAD_GETMEM (THREAD_SELF, tid);
         return 0;
   }
 #endif
@@ -104,7 +235,13 @@ PTHREAD_MUTEX_LOCK (pthread_mutex_t *mutex)
 
   if (__builtin_expect (type & ~(PTHREAD_MUTEX_KIND_MASK_NP
 				 | PTHREAD_MUTEX_ELISION_FLAGS_NP), 0))
-    return __pthread_mutex_lock_full (mutex);
+    {
+      if ((type & PTHREAD_MUTEX_KIND_MASK_NP) == PTHREAD_MUTEX_RECURSIVE_NP
+	  && (type & (PTHREAD_MUTEX_ROBUST_NORMAL_NP
+		      | PTHREAD_MUTEX_PRIO_INHERIT_NP)) != 0)
+	return __pthread_mutex_lock_full_shield (mutex);
+      return __pthread_mutex_lock_full (mutex);
+    }
 
   if (__glibc_likely (type == PTHREAD_MUTEX_TIMED_NP))
     {
@@ -156,6 +293,12 @@ PTHREAD_MUTEX_LOCK (pthread_mutex_t *mutex)
   else if (__builtin_expect (PTHREAD_MUTEX_TYPE (mutex)
 			  == PTHREAD_MUTEX_ADAPTIVE_NP, 1))
     {
+#if HP_TIMING_AVAIL
+      spin_learn_entry *learn = spin_learn_get (mutex);
+      if (learn != NULL)
+	lll_mutex_lock_learned (mutex, learn);
+      else
+#endif
       if (LLL_MUTEX_TRYLOCK (mutex) != 0)
 	{
 	  int cnt = 0;
@@ -208,6 +351,7 @@ PTHREAD_MUTEX_LOCK (pthread_mutex_t *mutex)
 #ifndef NO_INCR
   ++mutex->__data.__nusers;
 #endif
+  MUTEX_STATS_ACQUIRED (mutex);
 
   LIBC_PROBE (mutex_acquired, 1, mutex);
 
@@ -644,6 +788,7 @@ __pthread_mutex_lock_full (pthread_mutex_t *mutex)
 #ifndef NO_INCR
   ++mutex->__data.__nusers;
 #endif
+  MUTEX_STATS_ACQUIRED (mutex);
 
   LIBC_PROBE (mutex_acquired, 1, mutex);
 
@@ -0,0 +1,29 @@
+#ifndef PTHREAD_MUTEX_STATS_NP_H
+#define PTHREAD_MUTEX_STATS_NP_H
+
+#include <pthread.h>
+
+// Per-mutex contention statistics of the patched nptl.  Only collected
+// when glibc is built with MUTEX_STATS=1 (see mutex_stats.h); otherwise
+// both functions return ENOSYS / -1.
+struct pthread_mutex_stats_np {
+    const void* mutex;
+    unsigned long long acquisitions;  // real acquisitions of the lock word
+    unsigned long long contended;     // acquisitions that found it taken and blocked
+                                      // (0 for robust, PI and PP mutexes)
+    unsigned long long futex_waits;   // FUTEX_WAIT calls made by those
+    unsigned long long wait_ns;       // total time spent blocked in them
+    unsigned long long shield_skips;  // nested acquisitions served by the shield table
+};
+
+// 0 on success, ENOENT if MUTEX was never recorded (or was destroyed),
+// ENOSYS if disabled.
+extern int pthread_mutex_getstats_np(const pthread_mutex_t* mutex,
+                                     struct pthread_mutex_stats_np* stats);
+
+// Copy up to MAX entries, most contended first; returns the number copied,
+// or -1 if statistics are disabled.
+extern int pthread_mutex_stats_top_np(struct pthread_mutex_stats_np* stats,
+                                      int max);
+
+#endif // PTHREAD_MUTEX_STATS_NP_H
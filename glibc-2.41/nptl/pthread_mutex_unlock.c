@@ -24,6 +24,7 @@
 #include <futex-internal.h>
 #include <shlib-compat.h>
 #include "shield_arr.h"
+#include "mutex_spin_learn.h"
 
 static int
 __pthread_mutex_unlock_full (pthread_mutex_t *mutex, int decr)
@@ -57,26 +58,60 @@ __pthread_mutex_unlock_usercnt (pthread_mutex_t *mutex, int decr)
   int type = PTHREAD_MUTEX_TYPE_ELISION (mutex);
 #if 1
   if (__builtin_expect (type == PTHREAD_MUTEX_RECURSIVE_NP, 0)){
-    //LS_Status status = 
-    LS_RELEASE1(mutex, true, lll_unlock_wrapper);
-    /*if(status == LS_RELEASE_NOW)
-        mutex->__data.__owner = 0;*/
+    LS_Status status = LS_RELEASE1(mutex, true, lll_unlock_wrapper);
+    if (__glibc_unlikely (status == LS_UNBALANCED_UNLOCK))
+      {
+	/* Not in the shield table: the mutex either overflowed into
+	   __owner/__count or is not ours.  */
+	if (mutex->__data.__owner != THREAD_GETMEM (THREAD_SELF, tid))
+	  return EPERM;
+
+	if (--mutex->__data.__count != 0)
+	  /* We still hold the mutex.  */
+	  return 0;
+
+	mutex->__data.__owner = 0;
+	lll_unlock_wrapper (mutex);
+      }
     return 0;
   }
   else if(__builtin_expect (type == PTHREAD_MUTEX_ERRORCHECK, 0)){
     LS_Status status = LS_RELEASE1(mutex, false, lll_unlock_wrapper);
     if(status == LS_UNBALANCED_UNLOCK)
-      return EPERM;
-    /*if(status == LS_RELEASE_NOW)
-      mutex->__data.__owner = 0;*/
-          return 0;
+      {
+	if (mutex->__data.__owner != THREAD_GETMEM (THREAD_SELF, tid))
+	  return EPERM;
+
+	mutex->__data.__owner = 0;
+	lll_unlock_wrapper (mutex);
+      }
+    return 0;
   }
 #endif
 
   if (__builtin_expect (type
 			& ~(PTHREAD_MUTEX_KIND_MASK_NP
 			    |PTHREAD_MUTEX_ELISION_FLAGS_NP), 0))
-    return __pthread_mutex_unlock_full (mutex, decr);
+    {
+      /* Robust and PI recursive mutexes, see
+	 __pthread_mutex_lock_full_shield: nested unlocks only drop the
+	 shield count.  The outermost one (0), or one the table never held
+	 (-1), goes through the full path, which also checks ownership.  */
+      if ((type & PTHREAD_MUTEX_KIND_MASK_NP) == PTHREAD_MUTEX_RECURSIVE_NP
+	  && (type & (PTHREAD_MUTEX_ROBUST_NORMAL_NP
+		      | PTHREAD_MUTEX_PRIO_INHERIT_NP)) != 0
+	  && DecrementRef (mutex) > 0)
+	{
+	  /* Like the stock path, report a nested unlock of a robust mutex
+	     whose previous owner died and that was not made consistent.  */
+	  if ((type & PTHREAD_MUTEX_ROBUST_NORMAL_NP) != 0
+	      && __glibc_unlikely (mutex->__data.__owner
+				   == PTHREAD_MUTEX_INCONSISTENT))
+	    return ENOTRECOVERABLE;
+	  return 0;
+	}
+      return __pthread_mutex_unlock_full (mutex, decr);
+    }
 
   if (__builtin_expect (type, PTHREAD_MUTEX_TIMED_NP)
       == PTHREAD_MUTEX_TIMED_NP)
@@ -117,7 +152,16 @@ __pthread_mutex_unlock_usercnt (pthread_mutex_t *mutex, int decr)
 #endif
   else if (__builtin_expect (PTHREAD_MUTEX_TYPE (mutex)
 			      == PTHREAD_MUTEX_ADAPTIVE_NP, 1))
-    goto normal;
+    {
+#if HP_TIMING_AVAIL
+      /* Feed the hold time (and, with waiters, the release time) into
+	 the learned spin budget.  */
+      spin_learn_entry *learn = spin_learn_get (mutex);
+      if (learn != NULL)
+	spin_learn_release (learn, atomic_load_relaxed (&mutex->__data.__lock));
+#endif
+      goto normal;
+    }
 #if 0
   else
     {
@@ -0,0 +1,68 @@
+/* Copyright (C) 2002-2025 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <sysdep.h>
+#include <lowlevellock.h>
+#include <futex-internal.h>
+#include <pthread.h>
+#include <pthreadP.h>
+#include <stap-probe.h>
+#include <shlib-compat.h>
+#include "shield_arr.h"
+
+#include "pthread_rwlock_common.c"
+
+/* See pthread_rwlock_common.c for an overview.  */
+int
+___pthread_rwlock_unlock (pthread_rwlock_t *rwlock)
+{
+  LIBC_PROBE (rwlock_unlock, 1, rwlock);
+
+  /* We distinguish between having acquired a read vs. a write lock by looking
+     at the writer TID.  If it's equal to our TID, we must be the writer
+     because nobody else can have stored this value.  Also, if we are a
+     reader, we will read from the wrunlock store with value 0 by the most
+     recent writer because that writer happens-before us.  */
+  if (atomic_load_relaxed (&rwlock->__data.__cur_writer)
+      == THREAD_GETMEM (THREAD_SELF, tid))
+      __pthread_rwlock_wrunlock (rwlock);
+  else
+    {
+      /* Nested read unlocks only drop the TLS shield count.  The outermost
+	 one (0) and read locks the table could not hold (-1) release
+	 __readers.  Read locks taken by tryrdlock/timedrdlock bypass the
+	 shield, but every real acquisition is still paired with exactly one
+	 real release, so mixing them is safe.  */
+      if (DecrementRef (rwlock) > 0)
+	return 0;
+      __pthread_rwlock_rdunlock (rwlock);
+    }
+  return 0;
+}
+versioned_symbol (libc, ___pthread_rwlock_unlock, pthread_rwlock_unlock,
+		  GLIBC_2_34);
+libc_hidden_ver (___pthread_rwlock_unlock, __pthread_rwlock_unlock)
+
+#if OTHER_SHLIB_COMPAT (libpthread, GLIBC_2_1, GLIBC_2_34)
+compat_symbol (libpthread, ___pthread_rwlock_unlock, pthread_rwlock_unlock,
+	       GLIBC_2_1);
+#endif
+#if OTHER_SHLIB_COMPAT (libpthread, GLIBC_2_2, GLIBC_2_34)
+compat_symbol (libpthread, ___pthread_rwlock_unlock, __pthread_rwlock_unlock,
+	       GLIBC_2_2);
+#endif
@@ -16,7 +16,9 @@ typedef enum {
     LS_RELEASE_NOW,
     LS_SKIP_RELEASE,
     LS_UNBALANCED_LOCK,
-    LS_UNBALANCED_UNLOCK
+    LS_UNBALANCED_UNLOCK,
+    LS_OVERFLOW_ACQUIRE,    // acquired, but the table is full: caller tracks it
+    LS_OVERFLOW_HELD        // lock_fn found the lock already held outside the table
 } LS_Status;
 
 // Structure for each array entry
@@ -44,18 +46,21 @@ static inline LS_LockEntry* lookup(void* l) {
 }
 
 // --- TLS Increment ---
-static inline void IncrementRef(void* l) {
+// Returns false when l is not in the table and there is no free slot left;
+// the lock then has to be tracked by the lock implementation itself.
+static inline bool IncrementRef(void* l) {
     DEBUG_PRINT("In IncrementRef\n");
     LS_LockEntry* entry = lookup(l);
     if (!entry) {
-        if (lock_count <= MAX_LOCKS ) {
-            lock_table[lock_count].lock_ptr = l;
-            lock_table[lock_count].rec_count = 1;
-            lock_count++;
-        }
+        if (lock_count >= MAX_LOCKS)
+            return false;
+        lock_table[lock_count].lock_ptr = l;
+        lock_table[lock_count].rec_count = 1;
+        lock_count++;
     } else {
         entry->rec_count++;
     }
+    return true;
 }
 
 // --- TLS Decrement ---
@@ -64,18 +69,14 @@ static inline int DecrementRef(void* l) {
     LS_LockEntry* entry = lookup(l);
     if (!entry) return -1;
 
-    if (lock_count < MAX_LOCKS) {
-        int val = entry->rec_count;
-        if (val > 1) {
-            entry->rec_count--;
-            return val - 1;
-        } else {
-            int idx = entry - lock_table;
-            lock_table[idx] = lock_table[--lock_count];
-            return 0;
-        }
+    int val = entry->rec_count;
+    if (val > 1) {
+        entry->rec_count--;
+        return val - 1;
     }
-    return -1;
+    int idx = entry - lock_table;
+    lock_table[idx] = lock_table[--lock_count];
+    return 0;
 }
 
 // Typedef for locking/unlocking function pointer
@@ -85,14 +86,25 @@ typedef int (*LockFunc1)(void* l);
 typedef void (*UnlockFunc1)(void* l);
 
 // --- Shielding LS Layer ---
+//
+// The table only covers the first MAX_LOCKS distinct locks a thread holds.
+// Beyond that, LS_ACQUIRE* returns LS_OVERFLOW_ACQUIRE and the caller records
+// ownership itself (glibc uses the kernel-visible __owner/__count fields).
+// Because such a lock is not in the table, a nested acquisition reaches
+// __lock_fn again: lock_fn must return non-zero instead of blocking when the
+// caller already owns the lock, and LS_ACQUIRE* reports LS_OVERFLOW_HELD.
+// Releasing an untracked lock reports LS_UNBALANCED_UNLOCK, and the caller
+// falls back to its own bookkeeping.
 
 static LS_Status __attribute__((unused)) LS_ACQUIRE1(void* l , bool reentrant, LockFunc1 __lock_fn) {
     DEBUG_PRINT("In LS_ACQ_ENT\n");
 
     LS_LockEntry* entry = lookup(l);
     if (!entry) {
-        __lock_fn(l);
-        IncrementRef(l);
+        if (__lock_fn(l) != 0)
+            return LS_OVERFLOW_HELD;
+        if (!IncrementRef(l))
+            return LS_OVERFLOW_ACQUIRE;
         return LS_ACQUIRE_NOW;
     }
     if (reentrant){
@@ -107,8 +119,10 @@ static LS_Status __attribute__((unused)) LS_ACQUIRE2(void* l, void* me, bool ree
 
     LS_LockEntry* entry = lookup(l);
     if (!entry) {
-        __lock_fn(l, me);
-        IncrementRef(l);
+        if (__lock_fn(l, me) != 0)
+            return LS_OVERFLOW_HELD;
+        if (!IncrementRef(l))
+            return LS_OVERFLOW_ACQUIRE;
         return LS_ACQUIRE_NOW;
     }
     if (reentrant){
@@ -5,40 +5,62 @@
 #include<stdlib.h>
 #include<pthread.h>
 #include<sys/time.h>
+#include "../bench_stop.h"
+#include "../placement.h"
+#include "../perf_counters.h"
+#include "../cpu_usage.h"
 
 
 
 #ifdef SHIELD
 #include "shielding_array.h"
 #endif
+#ifdef MUTEX_STATS
+#include "nptl/pthread_mutex_stats_np.h"
+#define STATS_TOP_N 8
+#endif
 //using namespace std;
 
 #define NUM_ITERATIONS 100000000
 #define NUM_WARMUPITERATIONS 10000
-// CPU ranges
-#define CPU_RANGE1_START 64
-#define CPU_RANGE1_END 127
-#define CPU_RANGE2_START 192
-#define CPU_RANGE2_END 255
 
 int numWorkers;
+double run_seconds = 0;     // > 0: --duration=<sec> run instead of NUM_ITERATIONS
+long long* ops_completed;
+struct perf_group* perf_groups;    // one per thread, used with --perf
+struct cpu_usage* cpu_usages;      // one per thread, used with --cpu
+#ifdef RWLOCK
+pthread_rwlock_t mylock;
+#else
 pthread_mutex_t mylock;
+#endif
 pthread_barrier_t my_barrier;
 struct timeval timeStart, timeEnd;
 
+// Pin the calling thread according to --placement (placement.h)
 void set_cpu_affinity(int thread_index) {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    
-    int cpu_id;
-    if (thread_index < 64) {
-        cpu_id =  CPU_RANGE1_START + thread_index;
-    } else {
-        cpu_id =  CPU_RANGE2_START + (thread_index - 64);
+    placement_pin(thread_index);
+}
+
+#ifdef MUTEX_STATS
+// Top-N contended mutexes from the patched nptl, on stderr so the CSV line
+// on stdout is unchanged; called before mylock is destroyed, since destroy
+// drops its entry
+void dump_mutex_stats(void) {
+    struct pthread_mutex_stats_np top[STATS_TOP_N];
+    int n = pthread_mutex_stats_top_np(top, STATS_TOP_N);
+    if (n < 0) {
+        fprintf(stderr, "mutex stats: glibc built without MUTEX_STATS\n");
+        return;
     }
-    CPU_SET(cpu_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    fprintf(stderr, "mutex,acquisitions,contended,futex_waits,wait_ns,shield_skips\n");
+    for (int i = 0; i < n; i++)
+        fprintf(stderr, "%p%s,%llu,%llu,%llu,%llu,%llu\n", top[i].mutex,
+                top[i].mutex == (void*)&mylock ? "(mylock)" : "",
+                top[i].acquisitions, top[i].contended, top[i].futex_waits,
+                top[i].wait_ns, top[i].shield_skips);
 }
+#endif
 
 void* warmupFunction(void* arg) {
     //long args = (long)arg;
@@ -46,8 +68,13 @@ void* warmupFunction(void* arg) {
     set_cpu_affinity(thread_index);
     // Warm-up phase
     for (long i = 0; i < NUM_WARMUPITERATIONS; i++) {
+#ifdef RWLOCK
+        pthread_rwlock_rdlock(&mylock);
+        pthread_rwlock_unlock(&mylock);
+#else
         pthread_mutex_lock(&mylock);
         pthread_mutex_unlock(&mylock);
+#endif
     }
     return NULL;
 }
@@ -56,6 +83,7 @@ void* mainThreadFunction(void* arg) {
     //long args = (long)arg;
     long thread_index = *(long*)arg;
     set_cpu_affinity(thread_index);
+    perf_group_open(&perf_groups[thread_index]);
     // Main timed phase
 
     // Calculate iterations per thread
@@ -71,24 +99,57 @@ void* mainThreadFunction(void* arg) {
 #ifdef SHIELD
 	LS_ACQUIRE(&mylock, false, pthread_mutex_lock);
         LS_RELEASE(&mylock, false, pthread_mutex_unlock);
+#elif defined(RWLOCK)
+        // recursive read: the nested rdlock/unlock pair is elided by the shield
+        pthread_rwlock_rdlock(&mylock);
+        pthread_rwlock_rdlock(&mylock);
+        pthread_rwlock_unlock(&mylock);
+        pthread_rwlock_unlock(&mylock);
+#elif defined(ROBUST) || defined(PI)
+        // recursive re-acquisition: the nested pair skips the robust list / FUTEX_LOCK_PI
+        pthread_mutex_lock(&mylock);
+        pthread_mutex_lock(&mylock);
+        pthread_mutex_unlock(&mylock);
+        pthread_mutex_unlock(&mylock);
 #else
         pthread_mutex_lock(&mylock);
         pthread_mutex_unlock(&mylock);
 #endif
     }
     pthread_barrier_wait(&my_barrier);
-    if(thread_index == 0)
+    if(thread_index == 0) {
 	gettimeofday(&timeStart, 0);
+        if (run_seconds > 0)
+            bench_stop_start(run_seconds);
+    }
+    perf_group_start(&perf_groups[thread_index]);
+    cpu_usage_start(&cpu_usages[thread_index]);
 
-    for (long i = 0; i < iterations_per_thread; i++) {
+    long long i;
+    for (i = 0; run_seconds > 0 ? !bench_should_stop() : i < iterations_per_thread; i++) {
 #ifdef SHIELD
         LS_ACQUIRE(&mylock, false, pthread_mutex_lock);
         LS_RELEASE(&mylock, false, pthread_mutex_unlock);
+#elif defined(RWLOCK)
+        // recursive read: the nested rdlock/unlock pair is elided by the shield
+        pthread_rwlock_rdlock(&mylock);
+        pthread_rwlock_rdlock(&mylock);
+        pthread_rwlock_unlock(&mylock);
+        pthread_rwlock_unlock(&mylock);
+#elif defined(ROBUST) || defined(PI)
+        // recursive re-acquisition: the nested pair skips the robust list / FUTEX_LOCK_PI
+        pthread_mutex_lock(&mylock);
+        pthread_mutex_lock(&mylock);
+        pthread_mutex_unlock(&mylock);
+        pthread_mutex_unlock(&mylock);
 #else
         pthread_mutex_lock(&mylock);
         pthread_mutex_unlock(&mylock);
 #endif
     }
+    perf_group_stop(&perf_groups[thread_index]);
+    cpu_usage_stop(&cpu_usages[thread_index]);
+    ops_completed[thread_index] = i;
      pthread_barrier_wait(&my_barrier);
      if(thread_index == 0)
          gettimeofday(&timeEnd, 0);
@@ -96,12 +157,31 @@ void* mainThreadFunction(void* arg) {
 }
 
 int main(int argc, char* argv[]){
+    run_seconds = bench_parse_duration(&argc, argv);
+    placement_parse(&argc, argv);
+    perf_parse(&argc, argv);
+    cpu_usage_parse(&argc, argv);
     if(argc != 2) {
-        printf("usage:./<exe> <num_threads>\n");
+        printf("usage:./<exe> <num_threads> [--duration=<sec>] [--placement=<policy>] [--perf] [--cpu]\n");
         exit(0);
     }
 
-#ifdef RECURSIVE
+#ifdef RWLOCK
+    pthread_rwlock_init(&mylock, NULL);
+#elif defined(ROBUST) || defined(PI)
+    // robust-recursive or PI-recursive mutex
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+#ifdef ROBUST
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+#ifdef PI
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+#endif
+    pthread_mutex_init(&mylock, &attr);
+    pthread_mutexattr_destroy(&attr);
+#elif defined(RECURSIVE)
     pthread_mutexattr_t attr;
     pthread_mutexattr_init(&attr);
     pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
@@ -123,9 +203,16 @@ int main(int argc, char* argv[]){
 	long long elapsed=0;
 	//initializing number of workers.
 	numWorkers=atoi(argv[1]);
+	placement_log(stderr, numWorkers);
 	pthread_t Threads[numWorkers];
     pthread_barrier_init(&my_barrier,NULL, numWorkers);    
 	long thread_indices[numWorkers];    
+	long long ops[numWorkers];
+	ops_completed = ops;
+	struct perf_group perf[numWorkers];
+	struct cpu_usage cpu_use[numWorkers];
+	perf_groups = perf;
+	cpu_usages = cpu_use;
 	// struct timeval timeStart, timeEnd;
 
 	// printf("Num of thread:%d\n",numWorkers);
@@ -138,19 +225,32 @@ int main(int argc, char* argv[]){
     }
 
     // Wait for main threads to finish
+    long long total_ops = 0;
     for (int i = 0; i < numWorkers; i++) {
         pthread_join(Threads[i], NULL);
+        total_ops += ops_completed[i];
     }
+    bench_stop_join();
 	
 	// gettimeofday(&timeEnd, 0);
 	elapsed = (timeEnd.tv_sec-timeStart.tv_sec)*1000000LL + timeEnd.tv_usec-timeStart.tv_usec;
 	//printf ("\nDone. Throughput:	%f	calls/sec\n",NUM_ITERATIONS/(elapsed/(double)1000000));
 	  
 	
+#ifdef MUTEX_STATS
+	dump_mutex_stats();
+#endif
+#ifdef RWLOCK
+	pthread_rwlock_destroy(&mylock);
+#else
 	pthread_mutex_destroy(&mylock);
+#endif
     pthread_barrier_destroy(&my_barrier);    
 	//printf ("\nDone.	%f	sec\n",elapsed/(double)1000000);
-	printf ("%d,%f,%f\n",numWorkers, elapsed/(double)1000000, NUM_ITERATIONS/(elapsed/(double)1000000));
+	printf ("%d,%f,%f",numWorkers, elapsed/(double)1000000, total_ops/(elapsed/(double)1000000));
+	perf_print_columns(stdout, perf, numWorkers, total_ops);
+	cpu_usage_print_columns(stdout, cpu_use, numWorkers, total_ops);
+	printf ("\n");
 	return 0;
 }
 
@@ -39,13 +39,94 @@ gcc \
   -lpthread -DERRORCHECK\
 ;
 
+gcc \
+  -L "${glibc_install}/lib" \
+  -I "${glibc_install}/include" \
+  -Wl,--rpath="${glibc_install}/lib" \
+  -Wl,--dynamic-linker="${glibc_install}/lib/ld-linux-x86-64.so.2" \
+  -std=c11 \
+  -o pthread_benchmark_ls_rwlock \
+  pthread_benchmark.c \
+  -lpthread -DRWLOCK\
+;
+gcc -std=c11 -o pthread_benchmark_rwlock pthread_benchmark.c -lpthread -DRWLOCK
+
+# needs glibc built with MUTEX_STATS=1, see readme.md
+gcc \
+  -L "${glibc_install}/lib" \
+  -I "${glibc_install}/include" \
+  -Wl,--rpath="${glibc_install}/lib" \
+  -Wl,--dynamic-linker="${glibc_install}/lib/ld-linux-x86-64.so.2" \
+  -std=c11 \
+  -o pthread_benchmark_ls_stats \
+  pthread_benchmark.c \
+  -lpthread -DMUTEX_STATS\
+;
+
+gcc \
+  -L "${glibc_install}/lib" \
+  -I "${glibc_install}/include" \
+  -Wl,--rpath="${glibc_install}/lib" \
+  -Wl,--dynamic-linker="${glibc_install}/lib/ld-linux-x86-64.so.2" \
+  -std=c11 \
+  -o pthread_benchmark_ls_robust \
+  pthread_benchmark.c \
+  -lpthread -DROBUST\
+;
+gcc -std=c11 -o pthread_benchmark_robust pthread_benchmark.c -lpthread -DROBUST
+
+gcc \
+  -L "${glibc_install}/lib" \
+  -I "${glibc_install}/include" \
+  -Wl,--rpath="${glibc_install}/lib" \
+  -Wl,--dynamic-linker="${glibc_install}/lib/ld-linux-x86-64.so.2" \
+  -std=c11 \
+  -o pthread_benchmark_ls_pi \
+  pthread_benchmark.c \
+  -lpthread -DPI\
+;
+gcc -std=c11 -o pthread_benchmark_pi pthread_benchmark.c -lpthread -DPI
+
+gcc \
+  -L "${glibc_install}/lib" \
+  -I "${glibc_install}/include" \
+  -Wl,--rpath="${glibc_install}/lib" \
+  -Wl,--dynamic-linker="${glibc_install}/lib/ld-linux-x86-64.so.2" \
+  -std=c11 \
+  -o pthread_nesting_stress_ls \
+  pthread_nesting_stress.c \
+  -lpthread \
+;
+gcc -std=c11 -o pthread_nesting_stress_normal pthread_nesting_stress.c -lpthread
+
 for i in {1..10}
 	do
 	./pthread_benchmark_normal 64 >>results/pthread_benchmark_normal.csv
   ./pthread_benchmark_ls_normal 64 >>results/pthread_benchmark_ls_normal.csv
+	# same runs with the CPU cost columns (cpu_seconds,ops_per_cpu_sec,kernel_share,vol_csw,invol_csw)
+	./pthread_benchmark_normal 64 --cpu >>results/pthread_benchmark_normal_cpu.csv
+	./pthread_benchmark_ls_normal 64 --cpu >>results/pthread_benchmark_ls_normal_cpu.csv
 	./pthread_benchmark_ls_reentrant 64 >>results/pthread_benchmark_ls_reentrant.csv
 	./pthread_benchmark_ls_errorcheck 64 >>results/pthread_benchmark_ls_errorcheck.csv
+	./pthread_benchmark_robust 64 >>results/pthread_benchmark_robust.csv
+	./pthread_benchmark_ls_robust 64 >>results/pthread_benchmark_ls_robust.csv
+	./pthread_benchmark_pi 64 >>results/pthread_benchmark_pi.csv
+	./pthread_benchmark_ls_pi 64 >>results/pthread_benchmark_ls_pi.csv
+	for t in 1 2 4 8 16 32 64
+		do
+		./pthread_benchmark_rwlock $t >>results/pthread_benchmark_rwlock.csv
+		./pthread_benchmark_ls_rwlock $t >>results/pthread_benchmark_ls_rwlock.csv
+		done
+	for held in 1 2 4 5 8 16 32
+		do
+		./pthread_nesting_stress_normal 64 $held >>results/pthread_nesting_stress_normal.csv
+		./pthread_nesting_stress_ls 64 $held >>results/pthread_nesting_stress_ls.csv
+		done
 	done
+./pthread_benchmark_ls_stats 64 >>results/pthread_benchmark_ls_stats.csv 2>>results/pthread_mutex_stats.csv
+# repeat until the 95% CI is within 2% and summarise (median, IQR, clusters)
+# instead of appending one raw line per run; per-run samples go to *_samples.csv
+g++ -O3 -std=c++17 -o runbench ../runbench.cpp
+./runbench --samples=results/pthread_benchmark_normal_samples.csv -- ./pthread_benchmark_normal 64 >>results/pthread_benchmark_normal_summary.csv
+./runbench --samples=results/pthread_benchmark_ls_normal_samples.csv -- ./pthread_benchmark_ls_normal 64 >>results/pthread_benchmark_ls_normal_summary.csv
 date
-
-
@@ -0,0 +1,171 @@
+#define _GNU_SOURCE
+#include <sched.h> //needed for definition of CPU_ZERO
+#include<stdio.h>
+#include<stdlib.h>
+#include<pthread.h>
+#include<sys/time.h>
+#include "../bench_stop.h"
+#include "../placement.h"
+#include "../perf_counters.h"
+#include "../cpu_usage.h"
+
+// Holds <locks_held> distinct recursive mutexes per thread, re-acquiring each
+// one once while held, so every pass goes past the MAX_LOCKS shield table
+// once locks_held > 4.  Compile with -DSHARED_LOCKS to make all threads
+// contend on the same set of mutexes instead of a private set per thread.
+
+#define NUM_ITERATIONS 10000000
+#define NUM_WARMUPITERATIONS 10000
+#define MAX_HELD 32
+#define MAX_THREADS 256
+
+int numWorkers;
+int locksHeld;
+double run_seconds = 0;     // > 0: --duration=<sec> run instead of NUM_ITERATIONS
+long long* ops_completed;
+struct perf_group* perf_groups;    // one per thread, used with --perf
+struct cpu_usage* cpu_usages;      // one per thread, used with --cpu
+#ifdef SHARED_LOCKS
+pthread_mutex_t mylocks[MAX_HELD];
+#else
+pthread_mutex_t mylocks[MAX_THREADS][MAX_HELD];
+#endif
+pthread_barrier_t my_barrier;
+struct timeval timeStart, timeEnd;
+
+// Pin the calling thread according to --placement (placement.h)
+void set_cpu_affinity(int thread_index) {
+    placement_pin(thread_index);
+}
+
+void init_recursive(pthread_mutex_t* m) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(m, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+// Take every lock twice (outer + nested), then release in reverse order.
+static inline void hold_all(pthread_mutex_t* locks) {
+    for (int j = 0; j < locksHeld; j++) {
+        pthread_mutex_lock(&locks[j]);
+        pthread_mutex_lock(&locks[j]);
+    }
+    for (int j = locksHeld - 1; j >= 0; j--) {
+        pthread_mutex_unlock(&locks[j]);
+        pthread_mutex_unlock(&locks[j]);
+    }
+}
+
+void* mainThreadFunction(void* arg) {
+    long thread_index = *(long*)arg;
+    set_cpu_affinity(thread_index);
+    perf_group_open(&perf_groups[thread_index]);
+#ifdef SHARED_LOCKS
+    pthread_mutex_t* locks = mylocks;
+#else
+    pthread_mutex_t* locks = mylocks[thread_index];
+#endif
+
+    // Calculate iterations per thread
+    long long iterations_per_thread = NUM_ITERATIONS / numWorkers;
+    long long remaining_iterations = NUM_ITERATIONS % numWorkers;
+
+    // Give remaining iterations to the first few threads
+    if (thread_index < remaining_iterations) {
+        iterations_per_thread++;
+    }
+
+    for (long i = 0; i < NUM_WARMUPITERATIONS; i++)
+        hold_all(locks);
+
+    pthread_barrier_wait(&my_barrier);
+    if(thread_index == 0) {
+	gettimeofday(&timeStart, 0);
+        if (run_seconds > 0)
+            bench_stop_start(run_seconds);
+    }
+    perf_group_start(&perf_groups[thread_index]);
+    cpu_usage_start(&cpu_usages[thread_index]);
+
+    long long i;
+    for (i = 0; run_seconds > 0 ? !bench_should_stop() : i < iterations_per_thread; i++)
+        hold_all(locks);
+    perf_group_stop(&perf_groups[thread_index]);
+    cpu_usage_stop(&cpu_usages[thread_index]);
+    ops_completed[thread_index] = i;
+
+     pthread_barrier_wait(&my_barrier);
+     if(thread_index == 0)
+         gettimeofday(&timeEnd, 0);
+    return NULL;
+}
+
+int main(int argc, char* argv[]){
+    run_seconds = bench_parse_duration(&argc, argv);
+    placement_parse(&argc, argv);
+    perf_parse(&argc, argv);
+    cpu_usage_parse(&argc, argv);
+    if(argc != 3) {
+        printf("usage:./<exe> <num_threads> <locks_held 1-%d> [--duration=<sec>] [--placement=<policy>] [--perf] [--cpu]\n", MAX_HELD);
+        exit(0);
+    }
+
+	numWorkers=atoi(argv[1]);
+	locksHeld=atoi(argv[2]);
+	placement_log(stderr, numWorkers);
+    if (numWorkers <= 0 || numWorkers > MAX_THREADS || locksHeld <= 0 || locksHeld > MAX_HELD) {
+        fprintf(stderr, "Error: need 1-%d threads and 1-%d locks\n", MAX_THREADS, MAX_HELD);
+        exit(1);
+    }
+
+#ifdef SHARED_LOCKS
+    for (int j = 0; j < MAX_HELD; j++)
+        init_recursive(&mylocks[j]);
+#else
+    for (int t = 0; t < numWorkers; t++)
+        for (int j = 0; j < MAX_HELD; j++)
+            init_recursive(&mylocks[t][j]);
+#endif
+
+	long long elapsed=0;
+	pthread_t Threads[numWorkers];
+    pthread_barrier_init(&my_barrier,NULL, numWorkers);
+	long thread_indices[numWorkers];
+	long long ops[numWorkers];
+	ops_completed = ops;
+	struct perf_group perf[numWorkers];
+	struct cpu_usage cpu_use[numWorkers];
+	perf_groups = perf;
+	cpu_usages = cpu_use;
+
+    for (int i = 0; i < numWorkers; i++) {
+	thread_indices[i] = i;
+        pthread_create(&Threads[i], NULL, mainThreadFunction, &thread_indices[i]);
+    }
+
+    long long total_ops = 0;
+    for (int i = 0; i < numWorkers; i++) {
+        pthread_join(Threads[i], NULL);
+        total_ops += ops_completed[i];
+    }
+    bench_stop_join();
+
+	elapsed = (timeEnd.tv_sec-timeStart.tv_sec)*1000000LL + timeEnd.tv_usec-timeStart.tv_usec;
+
+#ifdef SHARED_LOCKS
+    for (int j = 0; j < MAX_HELD; j++)
+        pthread_mutex_destroy(&mylocks[j]);
+#else
+    for (int t = 0; t < numWorkers; t++)
+        for (int j = 0; j < MAX_HELD; j++)
+            pthread_mutex_destroy(&mylocks[t][j]);
+#endif
+    pthread_barrier_destroy(&my_barrier);
+	printf ("%d,%d,%f,%f",numWorkers, locksHeld, elapsed/(double)1000000, total_ops/(elapsed/(double)1000000));
+	perf_print_columns(stdout, perf, numWorkers, total_ops);
+	cpu_usage_print_columns(stdout, cpu_use, numWorkers, total_ops);
+	printf ("\n");
+	return 0;
+}
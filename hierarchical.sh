@@ -3,3 +3,22 @@ gcc -O3 -o hierarchical_benchmark hierarchical_lock_benchmark.c -lpthread
 gcc -O3 -o hierarchical_benchmark_PIN hierarchical_lock_benchmark.c -lpthread -DPIN_THR
 gcc -O3 cpu_affinity.c -o cpu_affinity -lpthread
 gcc -O3 cpu_hiera.c -o cpu_hiera -lpthread
+for q in MCS CLH HEMLOCK
+do
+	lower=$(echo $q | tr A-Z a-z)
+	gcc -O3 -o hierarchical_benchmark_$lower hierarchical_lock_benchmark.c -lpthread -DQLOCK_$q
+	gcc -O3 -o hierarchical_benchmark_${lower}_park hierarchical_lock_benchmark.c -lpthread -DQLOCK_$q -DQLOCK_PARK
+done
+# NUMA cohort locks in cpu_affinity; these builds pin (--placement=<policy>,
+# default compact) and append intra_node_handoffs,inter_node_handoffs,intra_ratio
+gcc -O3 cpu_affinity.c -o cpu_affinity_cbomcs -lpthread -DQLOCK_CBOMCS
+gcc -O3 cpu_affinity.c -o cpu_affinity_hmcs -lpthread -DQLOCK_HMCS
+# bare futex mutex; takes --futex-spin=<n> --futex-wake=one|all --futex-pause=pause|yield|none
+gcc -O3 -o hierarchical_benchmark_futex hierarchical_lock_benchmark.c -lpthread -DQLOCK_FUTEX
+# one-byte parking-lot locks; --locks runs 10M of them (or --locks=<n>) and
+# appends locks,lock_bytes,max_rss_kb, to hold against hierarchical_benchmark --locks
+gcc -O3 -o hierarchical_benchmark_parking_lot hierarchical_lock_benchmark.c -lpthread -DQLOCK_PARKING_LOT
+#for bin in hierarchical_benchmark hierarchical_benchmark_parking_lot
+#do
+#	./$bin 64 4 10 --duration=5 --locks >>results/${bin}_10M.csv
+#done
@@ -1,6 +1,4 @@
-#ifdef PIN_THR
 #define _GNU_SOURCE  // Add this at the very top
-#endif
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,13 +7,22 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <signal.h>
+#include <sys/resource.h>
+#include "bench_stop.h"
+#include "fairness.h"
+#include "lat_hist.h"
+#include "perf_counters.h"
+#include "cpu_usage.h"
 
 #ifdef PIN_THR
 #include <sched.h>        // For CPU_SET, CPU_ZERO, etc.
+#include "placement.h"
 #endif
+#include "qlock_select.h"     // last: -DQLOCK_* swaps pthread_mutex_t for a queue lock
 #define TOTAL_LOCKS 2000
 #define HIERARCHY_LEVELS 40
 #define LOCKS_PER_GROUP (TOTAL_LOCKS / HIERARCHY_LEVELS)  // 40 locks per group
+#define FOOTPRINT_LOCKS 10000000    // --locks default number of locks
 #define NUM_ITERATIONS 1000000
 #define WARMUP_ITERATIONS 10000  // Added warmup iterations
 
@@ -25,17 +32,9 @@ int get_num_cpus() {
     return sysconf(_SC_NPROCESSORS_ONLN);
 }
 
-// Function to set CPU affinity for a thread
+// Pin the calling thread to placement slot cpu_id (--placement, placement.h)
 int set_cpu_affinity(int cpu_id) {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    //CPU_SET(cpu_id, &cpuset);
-    for (int cpu = 0; cpu < 48; cpu++) {
-         CPU_SET(cpu, &cpuset);     // CPUs 0-23
-         CPU_SET(cpu + 48, &cpuset); // CPUs 48-71
-    }
-    
-    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    return placement_pin(cpu_id);
 }
 #endif
 
@@ -69,6 +68,9 @@ typedef struct {
     lock_group_t* lock_hierarchy;
     uint64_t* ops_completed;
     int is_warmup;              // Flag to indicate warmup phase
+    uint64_t* max_wait;         // Longest lock wait per thread (duration mode)
+    struct perf_group* perf;    // This thread's counters (--perf)
+    struct cpu_usage* cpu;     // This thread's CPU time (--cpu)
 #ifdef PIN_THR
     int cpu_id;              // Added CPU ID for affinity
 #endif
@@ -77,6 +79,13 @@ typedef struct {
 // Global variables
 uint64_t total_operations = 0;
 lock_group_t lock_hierarchy[HIERARCHY_LEVELS];
+double run_seconds = 0;     // > 0: --duration=<sec> run, with fairness columns
+// --locks[=<n>]: footprint mode, n locks in all (default FOOTPRINT_LOCKS)
+// instead of TOTAL_LOCKS, each pick a fresh random lock of its level, and
+// locks,lock_bytes,max_rss_kb appended to the output
+int total_locks = TOTAL_LOCKS;
+int footprint_mode = 0;
+static __thread unsigned int pick_seed;
 
 #ifdef PIN_THR
 int num_cpus;               // Store number of available CPUs
@@ -100,12 +109,27 @@ void do_work(int amount) {
 // Initialize lock hierarchy
 void init_lock_hierarchy() {
     for(int level = 0; level < HIERARCHY_LEVELS; level++) {
-        lock_hierarchy[level].locks = malloc(sizeof(pthread_mutex_t) * LOCKS_PER_GROUP);
-        lock_hierarchy[level].num_locks = LOCKS_PER_GROUP;
+        int per_group = total_locks / HIERARCHY_LEVELS;
+        lock_hierarchy[level].locks = malloc(sizeof(pthread_mutex_t) * per_group);
+        if (!lock_hierarchy[level].locks) {
+            perror("malloc");
+            exit(1);
+        }
+        lock_hierarchy[level].num_locks = per_group;
         lock_hierarchy[level].level = level;
         
-        for(int i = 0; i < LOCKS_PER_GROUP; i++) {
+        for(int i = 0; i < per_group; i++) {
+#ifdef ADAPTIVE
+            // PTHREAD_MUTEX_ADAPTIVE_NP; run with LS_ADAPTIVE_SPIN=learned on
+            // the patched glibc for the learned spin budget
+            pthread_mutexattr_t attr;
+            pthread_mutexattr_init(&attr);
+            pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ADAPTIVE_NP);
+            pthread_mutex_init(&lock_hierarchy[level].locks[i], &attr);
+            pthread_mutexattr_destroy(&attr);
+#else
             pthread_mutex_init(&lock_hierarchy[level].locks[i], NULL);
+#endif
         }
     }
 }
@@ -113,27 +137,38 @@ void init_lock_hierarchy() {
 // Cleanup lock hierarchy
 void cleanup_lock_hierarchy() {
     for(int level = 0; level < HIERARCHY_LEVELS; level++) {
-        for(int i = 0; i < LOCKS_PER_GROUP; i++) {
+        for(int i = 0; i < lock_hierarchy[level].num_locks; i++) {
             pthread_mutex_destroy(&lock_hierarchy[level].locks[i]);
         }
         free(lock_hierarchy[level].locks);
     }
 }
 
-// Acquire locks following hierarchy
-void acquire_hierarchical_locks(lock_group_t* hierarchy, int start_level, int depth) {
+// Acquire locks following hierarchy; with max_wait set, track the longest
+// single pthread_mutex_lock() in TSC ticks
+void acquire_hierarchical_locks(lock_group_t* hierarchy, int start_level, int depth, uint64_t* max_wait) {
     if (depth <= 0 || !keep_running) return;
     
     // Get random lock from current level
-    unsigned int seed = (unsigned int)pthread_self();
-    int lock_idx = rand_r(&seed) % hierarchy[start_level].num_locks;
+    unsigned int seed = footprint_mode ? pick_seed : (unsigned int)pthread_self();
+    int lock_idx = (footprint_mode ? ((unsigned int)rand_r(&seed) << 15 ^ rand_r(&seed))
+                                   : (unsigned int)rand_r(&seed)) % hierarchy[start_level].num_locks;
+    pick_seed = seed;
     
     // Acquire lock
-    pthread_mutex_lock(&hierarchy[start_level].locks[lock_idx]);
+    if (max_wait) {
+        uint64_t t0 = lat_now();
+        pthread_mutex_lock(&hierarchy[start_level].locks[lock_idx]);
+        uint64_t waited = lat_now() - t0;
+        if (waited > *max_wait)
+            *max_wait = waited;
+    } else {
+        pthread_mutex_lock(&hierarchy[start_level].locks[lock_idx]);
+    }
     
     // Recursively acquire locks at next level if needed
     if (depth > 1 && start_level + 1 < HIERARCHY_LEVELS) {
-        acquire_hierarchical_locks(hierarchy, start_level + 1, depth - 1);
+        acquire_hierarchical_locks(hierarchy, start_level + 1, depth - 1, max_wait);
     }
     
     // Do some work while holding locks
@@ -155,15 +190,24 @@ void* worker_thread(void* arg) {
 #endif 
 
     uint64_t local_ops = 0;
+    uint64_t local_max_wait = 0;
     unsigned int seed = args->thread_id;
+    pick_seed = args->thread_id * 7919 + 1;
     int iterations = args->is_warmup ? WARMUP_ITERATIONS : NUM_ITERATIONS;
+    int timed = !args->is_warmup && run_seconds > 0;
+    if (!args->is_warmup) {
+        perf_group_open(args->perf);
+        perf_group_start(args->perf);
+        cpu_usage_start(args->cpu);
+    }
     
-    for(int i = 0; i < iterations && keep_running; i++) {
+    for(int i = 0; (timed ? !bench_should_stop() : i < iterations) && keep_running; i++) {
         // Random starting level
         int start_level = rand_r(&seed) % (HIERARCHY_LEVELS - args->nesting_depth + 1);
         
         // Acquire locks following hierarchy
-        acquire_hierarchical_locks(args->lock_hierarchy, start_level, args->nesting_depth);
+        acquire_hierarchical_locks(args->lock_hierarchy, start_level, args->nesting_depth,
+                                   timed ? &local_max_wait : NULL);
         
         // Simulated work between operations
         do_work(args->work_amount);
@@ -172,7 +216,10 @@ void* worker_thread(void* arg) {
     }
     
     if (!args->is_warmup) {
+        perf_group_stop(args->perf);
+        cpu_usage_stop(args->cpu);
         args->ops_completed[args->thread_id] = local_ops;
+        args->max_wait[args->thread_id] = local_max_wait;
     }
     return NULL;
 }
@@ -193,7 +240,7 @@ void run_warmup(int num_threads, int nesting_depth, int work_amount) {
         thread_args[i].is_warmup = 1;
 
 #ifdef PIN_THR
-        thread_args[i].cpu_id = i % num_cpus;  // Distribute threads across CPUs
+        thread_args[i].cpu_id = i;  // placement slot, wraps past the last CPU
 #endif         
         pthread_create(&threads[i], NULL, worker_thread, &thread_args[i]);
     }
@@ -212,6 +259,9 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     pthread_t* threads = malloc(sizeof(pthread_t) * num_threads);
     thread_args_t* thread_args = malloc(sizeof(thread_args_t) * num_threads);
     uint64_t* ops_completed = calloc(num_threads, sizeof(uint64_t));
+    uint64_t* max_wait = calloc(num_threads, sizeof(uint64_t));
+    struct perf_group* perf = calloc(num_threads, sizeof(struct perf_group));
+    struct cpu_usage* cpu_use = calloc(num_threads, sizeof(struct cpu_usage));
     
     // Initialize lock hierarchy
     init_lock_hierarchy();
@@ -223,6 +273,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     
     // Start timing
     uint64_t start_time = get_time_usec();
+    if (run_seconds > 0)
+        bench_stop_start(run_seconds);
     
     // Create threads for main benchmark
     for(int i = 0; i < num_threads; i++) {
@@ -232,10 +284,13 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
         thread_args[i].work_amount = work_amount;
         thread_args[i].lock_hierarchy = lock_hierarchy;
         thread_args[i].ops_completed = ops_completed;
+        thread_args[i].max_wait = max_wait;
+        thread_args[i].perf = &perf[i];
+        thread_args[i].cpu = &cpu_use[i];
         thread_args[i].is_warmup = 0;
 
 #ifdef PIN_THR
-        thread_args[i].cpu_id = i % num_cpus;  // Distribute threads across CPUs
+        thread_args[i].cpu_id = i;  // placement slot, wraps past the last CPU
 #endif          
         pthread_create(&threads[i], NULL, worker_thread, &thread_args[i]);
     }
@@ -247,6 +302,7 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     }
     
     uint64_t end_time = get_time_usec();
+    bench_stop_join();
     double duration = (end_time - start_time) / 1000000.0;    
     // Print results
 /*    printf("\nHierarchical Lock Benchmark Results:\n");
@@ -265,19 +321,80 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     printf("- Average latency: %.2f microseconds\n", 
            (duration * 1000000) / total_operations);
 */
-    printf("%d,%d,%d,%.2f,%.2f\n",num_threads, nesting_depth, work_amount,duration,total_operations / duration);    
+    printf("%d,%d,%d,%.2f,%.2f",num_threads, nesting_depth, work_amount,duration,total_operations / duration);
+    if (run_seconds > 0) {
+        // jain,min_max,min_ops,max_ops,max_wait_us
+        uint64_t longest = 0;
+        for(int i = 0; i < num_threads; i++)
+            if (max_wait[i] > longest)
+                longest = max_wait[i];
+        struct fairness f = fairness_compute(ops_completed, num_threads);
+        printf(",%f,%f,%lu,%lu,%.2f", f.jain, f.min_max, f.min_ops, f.max_ops,
+               longest / lat_tsc_per_ns() / 1000.0);
+    }
+    perf_print_columns(stdout, perf, num_threads, total_operations);
+    cpu_usage_print_columns(stdout, cpu_use, num_threads, total_operations);
+    if (footprint_mode) {
+        // the locks themselves, plus the waiter table they share if any
+        size_t lock_bytes = sizeof(pthread_mutex_t) * (size_t)(total_locks / HIERARCHY_LEVELS) * HIERARCHY_LEVELS;
+#ifdef QLOCK_PARKING_LOT
+        lock_bytes += sizeof(pl_buckets);
+#endif
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        printf(",%d,%zu,%ld", total_locks, lock_bytes, ru.ru_maxrss);
+    }
+    printf("\n");
     // Cleanup
     cleanup_lock_hierarchy();
     free(threads);
     free(thread_args);
     free(ops_completed);
+    free(max_wait);
+    free(perf);
+    free(cpu_use);
+}
+
+// Pull --locks[=<n>] out of argv
+void parse_locks(int* argc, char** argv) {
+    int out = 1;
+    for (int i = 1; i < *argc; i++) {
+        if (strcmp(argv[i], "--locks") == 0) {
+            footprint_mode = 1;
+            total_locks = FOOTPRINT_LOCKS;
+        } else if (strncmp(argv[i], "--locks=", 8) == 0) {
+            footprint_mode = 1;
+            total_locks = atoi(argv[i] + 8);
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argv[out] = NULL;
+    *argc = out;
+    if (total_locks < HIERARCHY_LEVELS) {
+        fprintf(stderr, "Error: --locks needs at least %d locks, one per level\n", HIERARCHY_LEVELS);
+        exit(1);
+    }
 }
 
 int main(int argc, char* argv[]) {
     signal(SIGINT, handle_sigint);
 
+    run_seconds = bench_parse_duration(&argc, argv);
+    perf_parse(&argc, argv);
+    cpu_usage_parse(&argc, argv);
+    qlock_parse(&argc, argv);
+    parse_locks(&argc, argv);
+#ifdef PIN_THR
+    placement_parse(&argc, argv);
+#endif
     if(argc != 4) {
-        printf("Usage: %s <num_threads> <nesting_depth> <work_amount>\n", argv[0]);
+        printf("Usage: %s <num_threads> <nesting_depth> <work_amount> [--duration=<sec>] [--perf] [--cpu]"
+               " [--locks[=<n>]]"
+#ifdef PIN_THR
+               " [--placement=<policy>]"
+#endif
+               "\n", argv[0]);
         exit(1);
     }
     
@@ -301,6 +418,9 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
+#ifdef PIN_THR
+    placement_log(stderr, thread_counts);
+#endif
     run_benchmark(thread_counts, nesting_depths, work_amounts);
     
     return 0;
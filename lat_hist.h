@@ -0,0 +1,120 @@
+#ifndef LAT_HIST_H
+#define LAT_HIST_H
+
+// Per-thread latency histograms for the lock benchmarks.
+//
+// Timestamps come from the TSC (cntvct_el0 on aarch64, CLOCK_MONOTONIC
+// elsewhere) and are recorded in cycles into log-linear buckets: one
+// power-of-two group per leading bit, split into LAT_SUB_BUCKETS linear
+// steps, so every bucket is within 1/LAT_SUB_BUCKETS of its value.  A
+// thread only ever touches its own histogram; lat_hist_merge() folds them
+// together after the run and lat_tsc_per_ns() converts back to time.
+//
+// Plain C so the .c harnesses can include it as well.
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define LAT_SUB_BITS 3
+#define LAT_SUB_BUCKETS (1 << LAT_SUB_BITS)
+#define LAT_BUCKETS (64 * LAT_SUB_BUCKETS)
+
+struct lat_hist {
+    uint64_t count;
+    uint64_t max;
+    uint64_t bucket[LAT_BUCKETS];
+};
+
+static inline uint64_t lat_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static inline void lat_hist_init(struct lat_hist* h) {
+    memset(h, 0, sizeof(*h));
+}
+
+static inline int lat_bucket(uint64_t v) {
+    if (v < LAT_SUB_BUCKETS)
+        return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int sub = (int)(v >> (msb - LAT_SUB_BITS)) & (LAT_SUB_BUCKETS - 1);
+    return (msb - LAT_SUB_BITS + 1) * LAT_SUB_BUCKETS + sub;
+}
+
+// Smallest value that lands in bucket b
+static inline uint64_t lat_bucket_low(int b) {
+    if (b < LAT_SUB_BUCKETS)
+        return (uint64_t)b;
+    int msb = b / LAT_SUB_BUCKETS + LAT_SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(b % LAT_SUB_BUCKETS);
+    return (1ULL << msb) | (sub << (msb - LAT_SUB_BITS));
+}
+
+static inline void lat_hist_record(struct lat_hist* h, uint64_t v) {
+    h->bucket[lat_bucket(v)]++;
+    h->count++;
+    if (v > h->max)
+        h->max = v;
+}
+
+static inline void lat_hist_merge(struct lat_hist* dst, const struct lat_hist* src) {
+    for (int b = 0; b < LAT_BUCKETS; b++)
+        dst->bucket[b] += src->bucket[b];
+    dst->count += src->count;
+    if (src->max > dst->max)
+        dst->max = src->max;
+}
+
+// Value (cycles) at quantile q in [0,1]; reports the middle of the bucket
+static inline uint64_t lat_hist_quantile(const struct lat_hist* h, double q) {
+    if (h->count == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(q * (h->count - 1)) + 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < LAT_BUCKETS; b++) {
+        seen += h->bucket[b];
+        if (seen >= rank) {
+            uint64_t lo = lat_bucket_low(b);
+            uint64_t hi = b + 1 < LAT_BUCKETS ? lat_bucket_low(b + 1) : h->max;
+            uint64_t mid = lo + (hi - lo) / 2;
+            return mid < h->max ? mid : h->max;
+        }
+    }
+    return h->max;
+}
+
+static double lat_tsc_per_ns_cached;
+
+// Ticks of lat_now() per nanosecond, measured against CLOCK_MONOTONIC at
+// the first call (a 20 ms busy loop) and cached, so every column of a run
+// uses the same calibration
+static inline double lat_tsc_per_ns(void) {
+    if (lat_tsc_per_ns_cached > 0)
+        return lat_tsc_per_ns_cached;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint64_t c0 = lat_now();
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+    } while ((t1.tv_sec - t0.tv_sec) * 1000000000LL + (t1.tv_nsec - t0.tv_nsec) < 20000000LL);
+    uint64_t c1 = lat_now();
+    double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    lat_tsc_per_ns_cached = (c1 - c0) / ns;
+    return lat_tsc_per_ns_cached;
+}
+
+#endif // LAT_HIST_H
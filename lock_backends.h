@@ -0,0 +1,385 @@
+#ifndef LOCK_BACKENDS_H
+#define LOCK_BACKENDS_H
+
+// Lock backends for lockbench.  Every backend is a small struct with
+// lock()/unlock() and a static `reentrant` flag telling whether the same
+// thread may nest acquisitions (--nesting > 1).  lockbench instantiates its
+// worker loop once per backend, so the calls are resolved at compile time
+// and inline just like the old one-binary-per--D builds.
+//
+// lockbench runs its critical sections through execute_under_lock(l, f),
+// which brackets f with lock()/unlock().  Backends that run critical
+// sections on another thread's behalf (flat combining, delegation) have
+// execute() instead and an overload of execute_under_lock.
+//
+// Reader-writer backends also have lock_shared()/unlock_shared(), which
+// execute_shared(l, f) uses for lockbench's --read-pct reads; sequence
+// locks have read_begin()/read_validate() instead and execute_shared()
+// reruns f until it read a consistent snapshot.  For every other backend
+// a read is just another execute_under_lock().
+
+#include <pthread.h>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#if __has_include(<boost/thread/mutex.hpp>)
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#define LOCKBENCH_HAVE_BOOST 1
+#endif
+#include "shielding_array.h"
+#include "queue_locks.h"
+#include "numa_locks.h"
+#include "ticket_locks.h"
+#include "futex_mutex.h"
+#include "parking_lot.h"
+#include "biased_lock.h"
+#include "rw_locks.h"
+#include "seqlock.h"
+#include "combining.h"
+#include "delegation.h"
+
+template <class L, class F>
+inline void execute_under_lock(L& l, F&& f) {
+    l.lock();
+    f();
+    l.unlock();
+}
+
+template <class L, class = void>
+struct has_shared : std::false_type {};
+template <class L>
+struct has_shared<L, std::void_t<decltype(std::declval<L&>().lock_shared())>> : std::true_type {};
+
+template <class L, class = void>
+struct has_optimistic : std::false_type {};
+template <class L>
+struct has_optimistic<L, std::void_t<decltype(std::declval<L&>().read_begin())>> : std::true_type {};
+
+template <class L, class F>
+inline void execute_shared(L& l, F&& f) {
+    if constexpr (has_optimistic<L>::value) {
+        unsigned v;
+        do {
+            v = l.read_begin();
+            f();
+        } while (!l.read_validate(v));
+    } else if constexpr (has_shared<L>::value) {
+        l.lock_shared();
+        f();
+        l.unlock_shared();
+    } else {
+        execute_under_lock(l, f);
+    }
+}
+
+// pthread_mutex_t with a given type (pthread_benchmark.cpp default,
+// -DRECURSIVE, -DERRORCHECK)
+template <int Type>
+struct PthreadMutex {
+    static constexpr bool reentrant = (Type == PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_t m;
+    PthreadMutex() {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, Type);
+        pthread_mutex_init(&m, &attr);
+        pthread_mutexattr_destroy(&attr);
+    }
+    ~PthreadMutex() { pthread_mutex_destroy(&m); }
+    void lock() { pthread_mutex_lock(&m); }
+    void unlock() { pthread_mutex_unlock(&m); }
+};
+
+// Read side of pthread_rwlock_t (pthread_benchmark.cpp -DRWLOCK).  POSIX
+// allows a thread to take the read lock recursively.
+struct PthreadRwlockRead {
+    static constexpr bool reentrant = true;
+    pthread_rwlock_t m;
+    PthreadRwlockRead() { pthread_rwlock_init(&m, NULL); }
+    ~PthreadRwlockRead() { pthread_rwlock_destroy(&m); }
+    void lock() { pthread_rwlock_rdlock(&m); }
+    void unlock() { pthread_rwlock_unlock(&m); }
+};
+
+// std::mutex / std::recursive_mutex (mutex_bench.cpp default, -DNESTED)
+template <class M, bool Reentrant>
+struct StdLock {
+    static constexpr bool reentrant = Reentrant;
+    M m;
+    void lock() { m.lock(); }
+    void unlock() { m.unlock(); }
+};
+
+// Shared side of std::shared_mutex (mutex_bench.cpp -DRW)
+struct StdSharedRead {
+    static constexpr bool reentrant = false;
+    std::shared_mutex m;
+    void lock() { m.lock_shared(); }
+    void unlock() { m.unlock_shared(); }
+};
+
+// Both sides of pthread_rwlock_t and std::shared_mutex, for --read-pct
+struct PthreadRwlock {
+    static constexpr bool reentrant = false;
+    pthread_rwlock_t m;
+    PthreadRwlock() { pthread_rwlock_init(&m, NULL); }
+    ~PthreadRwlock() { pthread_rwlock_destroy(&m); }
+    void lock() { pthread_rwlock_wrlock(&m); }
+    void unlock() { pthread_rwlock_unlock(&m); }
+    void lock_shared() { pthread_rwlock_rdlock(&m); }
+    void unlock_shared() { pthread_rwlock_unlock(&m); }
+};
+
+struct StdSharedMutex {
+    static constexpr bool reentrant = false;
+    std::shared_mutex m;
+    void lock() { m.lock(); }
+    void unlock() { m.unlock(); }
+    void lock_shared() { m.lock_shared(); }
+    void unlock_shared() { m.unlock_shared(); }
+};
+
+// BRAVO (rw_locks.h) in front of any of the RW backends
+template <class RW>
+struct Bravo {
+    static constexpr bool reentrant = false;
+    RW inner;
+    bravo_t b;
+    Bravo() { bravo_init(&b); }
+    void lock() {
+        inner.lock();
+        bravo_revoke(&b);
+    }
+    void unlock() { inner.unlock(); }
+    void lock_shared() {
+        if (!bravo_read_fast(&b)) {
+            inner.lock_shared();
+            bravo_read_slow(&b);
+        }
+    }
+    void unlock_shared() {
+        if (!bravo_read_release(&b))
+            inner.unlock_shared();
+    }
+};
+
+// Per-CPU or per-NUMA-node reader indicators (rw_locks.h)
+template <int PerNode>
+struct DistributedRw {
+    static constexpr bool reentrant = false;
+    drw_lock_t m;
+    DistributedRw() { drw_init(&m, PerNode); }
+    ~DistributedRw() { drw_destroy(&m); }
+    void lock() { drw_write_lock(&m); }
+    void unlock() { drw_write_unlock(&m); }
+    void lock_shared() { drw_read_lock(&m); }
+    void unlock_shared() { drw_read_unlock(&m); }
+};
+
+// Sequence lock (seqlock.h) whose writers exclude each other with any
+// other backend; readers go optimistic through execute_shared()
+template <class L>
+struct Seqlock {
+    static constexpr bool reentrant = false;
+    L writers;
+    seq_t s;
+    Seqlock() { seq_init(&s); }
+    void lock() {
+        writers.lock();
+        seq_write_begin(&s);
+    }
+    void unlock() {
+        seq_write_end(&s);
+        writers.unlock();
+    }
+    unsigned read_begin() { return seq_read_begin(&s); }
+    bool read_validate(unsigned v) { return seq_read_validate(&s, v); }
+};
+
+#ifdef _OPENMP
+// omp_lock_t / omp_nest_lock_t (omp_bench.cpp default, -DNESTED)
+struct OmpLock {
+    static constexpr bool reentrant = false;
+    omp_lock_t m;
+    OmpLock() { omp_init_lock(&m); }
+    ~OmpLock() { omp_destroy_lock(&m); }
+    void lock() { omp_set_lock(&m); }
+    void unlock() { omp_unset_lock(&m); }
+};
+
+struct OmpNestLock {
+    static constexpr bool reentrant = true;
+    omp_nest_lock_t m;
+    OmpNestLock() { omp_init_nest_lock(&m); }
+    ~OmpNestLock() { omp_destroy_nest_lock(&m); }
+    void lock() { omp_set_nest_lock(&m); }
+    void unlock() { omp_unset_nest_lock(&m); }
+};
+#endif
+
+// Built-in queue locks (queue_locks.h), spin-only or spin-then-park
+template <bool Park>
+struct McsLock {
+    static constexpr bool reentrant = false;
+    mcs_lock_t m;
+    McsLock() { mcs_init(&m, Park); }
+    ~McsLock() { mcs_destroy(&m); }
+    void lock() { mcs_lock(&m); }
+    void unlock() { mcs_unlock(&m); }
+};
+
+template <bool Park>
+struct ClhLock {
+    static constexpr bool reentrant = false;
+    clh_lock_t m;
+    ClhLock() { clh_init(&m, Park); }
+    ~ClhLock() { clh_destroy(&m); }
+    void lock() { clh_lock(&m); }
+    void unlock() { clh_unlock(&m); }
+};
+
+template <bool Park>
+struct Hemlock {
+    static constexpr bool reentrant = false;
+    hemlock_t m;
+    Hemlock() { hemlock_init(&m, Park); }
+    ~Hemlock() { hemlock_destroy(&m); }
+    void lock() { hemlock_lock(&m); }
+    void unlock() { hemlock_unlock(&m); }
+};
+
+// NUMA cohort locks (numa_locks.h)
+struct CboMcsLock {
+    static constexpr bool reentrant = false;
+    cbomcs_lock_t m;
+    CboMcsLock() { cbomcs_init(&m); }
+    ~CboMcsLock() { cbomcs_destroy(&m); }
+    void lock() { cbomcs_lock(&m); }
+    void unlock() { cbomcs_unlock(&m); }
+};
+
+struct HmcsLock {
+    static constexpr bool reentrant = false;
+    hmcs_lock_t m;
+    HmcsLock() { hmcs_init(&m); }
+    ~HmcsLock() { hmcs_destroy(&m); }
+    void lock() { hmcs_lock(&m); }
+    void unlock() { hmcs_unlock(&m); }
+};
+
+// Ticket locks (ticket_locks.h)
+struct TicketLock {
+    static constexpr bool reentrant = false;
+    ticket_lock_t m;
+    TicketLock() { ticket_init(&m); }
+    void lock() { ticket_lock(&m); }
+    void unlock() { ticket_unlock(&m); }
+};
+
+struct PartitionedTicketLock {
+    static constexpr bool reentrant = false;
+    pticket_lock_t m;
+    PartitionedTicketLock() { pticket_init(&m); }
+    void lock() { pticket_lock(&m); }
+    void unlock() { pticket_unlock(&m); }
+};
+
+struct TwaLock {
+    static constexpr bool reentrant = false;
+    twa_lock_t m;
+    TwaLock() { twa_init(&m); }
+    void lock() { twa_lock(&m); }
+    void unlock() { twa_unlock(&m); }
+};
+
+// Raw three-state futex mutex (futex_mutex.h); spin, wake and pause
+// policy come from the futex_mutex_* globals
+struct FutexMutex {
+    static constexpr bool reentrant = false;
+    futex_mutex_t m;
+    FutexMutex() { futex_mutex_init(&m); }
+    ~FutexMutex() { futex_mutex_destroy(&m); }
+    void lock() { futex_mutex_lock(&m); }
+    void unlock() { futex_mutex_unlock(&m); }
+};
+
+// One-byte lock, waiters parked in the global table of parking_lot.h
+struct ParkingLotLock {
+    static constexpr bool reentrant = false;
+    pl_lock_t m;
+    ParkingLotLock() { pl_init(&m); }
+    void lock() { pl_lock(&m); }
+    void unlock() { pl_unlock(&m); }
+};
+
+// Biased lock (biased_lock.h); thresholds from the biased_* globals
+struct BiasedLock {
+    static constexpr bool reentrant = false;
+    biased_lock_t m;
+    BiasedLock() { biased_init(&m); }
+    ~BiasedLock() { biased_destroy(&m); }
+    void lock() { biased_lock(&m); }
+    void unlock() { biased_unlock(&m); }
+};
+
+// Flat combining (combining.h): no lock()/unlock(), the closure runs on
+// whichever thread is combining
+struct FlatCombining {
+    static constexpr bool reentrant = false;
+    fc_lock_t m;
+    FlatCombining() { fc_init(&m); }
+    ~FlatCombining() { fc_destroy(&m); }
+    template <class F>
+    void execute(F& f) {
+        fc_execute(&m, [](void* p) { (*static_cast<F*>(p))(); }, &f);
+    }
+};
+
+template <class F>
+inline void execute_under_lock(FlatCombining& l, F&& f) {
+    l.execute(f);
+}
+
+// Delegation to a server thread (delegation.h), pinned to the last
+// placement slot so that with fewer threads than slots it has a CPU to
+// itself
+struct DelegationLock {
+    static constexpr bool reentrant = false;
+    dlg_lock_t m;
+    DelegationLock() {
+        dlg_init(&m, placement.policy == PLACE_NONE || placement.nslots == 0
+                         ? -1 : placement_cpu_of(placement.nslots - 1));
+    }
+    ~DelegationLock() { dlg_destroy(&m); }
+    template <class F>
+    void execute(F& f) {
+        dlg_execute(&m, [](void* p) { (*static_cast<F*>(p))(); }, &f);
+    }
+};
+
+template <class F>
+inline void execute_under_lock(DelegationLock& l, F&& f) {
+    l.execute(f);
+}
+
+// LockShield array mode on top of any backend (pthread_benchmark.cpp and
+// mutex_bench.cpp -DSHIELD_A).  With Reentrant the shield absorbs nested
+// acquisitions, so even a non-recursive inner lock can be nested.
+template <class L, bool Reentrant>
+struct Shielded {
+    static constexpr bool reentrant = Reentrant;
+    L inner;
+    void lock() {
+        LS_ACQUIRE(&inner, Reentrant, [](void* l) { static_cast<L*>(l)->lock(); });
+    }
+    void unlock() {
+        LS_RELEASE(&inner, Reentrant, [](void* l) { static_cast<L*>(l)->unlock(); });
+    }
+};
+
+#endif // LOCK_BACKENDS_H
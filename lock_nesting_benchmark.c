@@ -1,3 +1,4 @@
+#define _GNU_SOURCE  // RUSAGE_THREAD in cpu_usage.h
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -5,6 +6,10 @@
 #include <time.h>
 #include <unistd.h>
 #include <stdint.h>
+#include "bench_stop.h"
+#include "perf_counters.h"
+#include "cpu_usage.h"
+#include "qlock_select.h"     // last: -DQLOCK_* swaps pthread_mutex_t for a queue lock
 
 // Configuration parameters
 #define MAX_LOCKS 32
@@ -23,11 +28,14 @@ typedef struct {
     int work_amount;  // Simulated work between locks
     protected_counter_t* counters;
     uint64_t* ops_completed;
+    struct perf_group* perf;    // This thread's counters (--perf)
+    struct cpu_usage* cpu;     // This thread's CPU time (--cpu)
 } thread_args_t;
 
 // Global variables
 protected_counter_t counters[MAX_LOCKS];
 uint64_t total_operations = 0;
+double run_seconds = 0;     // > 0: --duration=<sec> run instead of NUM_ITERATIONS
 
 // Get time in microseconds
 uint64_t get_time_usec() {
@@ -67,7 +75,11 @@ void* worker_thread(void* arg) {
     // Seed random for this thread
     unsigned int seed = args->thread_id;
     
-    for(int i = 0; i < NUM_ITERATIONS; i++) {
+    int timed = run_seconds > 0;
+    perf_group_open(args->perf);
+    perf_group_start(args->perf);
+    cpu_usage_start(args->cpu);
+    for(int i = 0; timed ? !bench_should_stop() : i < NUM_ITERATIONS; i++) {
         // Random starting lock
         // int start_lock = rand_r(&seed) % MAX_LOCKS; ///Check this cycle
         int start_lock = 0;
@@ -80,6 +92,8 @@ void* worker_thread(void* arg) {
         local_ops++;
     }
     
+    perf_group_stop(args->perf);
+    cpu_usage_stop(args->cpu);
     args->ops_completed[args->thread_id] = local_ops;
     return NULL;
 }
@@ -111,6 +125,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
         free(thread_args);
         return;
     }
+    struct perf_group* perf = calloc(num_threads, sizeof(struct perf_group));
+    struct cpu_usage* cpu_use = calloc(num_threads, sizeof(struct cpu_usage));
     // Initialize mutexes
     for(int i = 0; i < MAX_LOCKS; i++) {
         pthread_mutex_init(&counters[i].mutex, NULL);
@@ -119,6 +135,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     
     // Start timing
     uint64_t start_time = get_time_usec();
+    if (run_seconds > 0)
+        bench_stop_start(run_seconds);
     
     // Create threads
     for(int i = 0; i < num_threads; i++) {
@@ -128,6 +146,8 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
         thread_args[i].work_amount = work_amount;
         thread_args[i].counters = counters;
         thread_args[i].ops_completed = ops_completed;
+        thread_args[i].perf = &perf[i];
+        thread_args[i].cpu = &cpu_use[i];
         
         pthread_create(&threads[i], NULL, worker_thread, &thread_args[i]);
     }
@@ -139,6 +159,7 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     }
     
     uint64_t end_time = get_time_usec();
+    bench_stop_join();
     double duration = (end_time - start_time) / 1000000.0; // Convert to seconds
     
     // Print results
@@ -151,7 +172,10 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
 //    printf("Average latency: %.2f microseconds\n", 
 //           (duration * 1000000) / total_operations);
 //    printf("\n");
-      printf("%d,%d,%d,%.2f,%.2f\n",num_threads, nesting_depth, work_amount,duration,total_operations / duration);
+      printf("%d,%d,%d,%.2f,%.2f",num_threads, nesting_depth, work_amount,duration,total_operations / duration);
+      perf_print_columns(stdout, perf, num_threads, total_operations);
+      cpu_usage_print_columns(stdout, cpu_use, num_threads, total_operations);
+      printf("\n");
     
     // Cleanup
     for(int i = 0; i < MAX_LOCKS; i++) {
@@ -161,12 +185,18 @@ void run_benchmark(int num_threads, int nesting_depth, int work_amount) {
     free(threads);
     free(thread_args);
     free(ops_completed);
+    free(perf);
+    free(cpu_use);
 }
 
 int main(int argc, char* argv[]) {
+    run_seconds = bench_parse_duration(&argc, argv);
+    perf_parse(&argc, argv);
+    cpu_usage_parse(&argc, argv);
+    qlock_parse(&argc, argv);
     if(argc != 4) {
         fprintf(stderr, "Error: Incorrect number of arguments\n");
-        printf("Usage: %s <num_threads> <nesting_depth> <work_amount>\n", argv[0]);
+        printf("Usage: %s <num_threads> <nesting_depth> <work_amount> [--duration=<sec>] [--perf] [--cpu]\n", argv[0]);
         exit(1);
     }
     
@@ -0,0 +1,931 @@
+// lockbench: one driver for all lock variants that pthread_benchmark.cpp,
+// mutex_bench.cpp, omp_bench.cpp and boost_bench.cpp used to select with -D.
+// It also carries the built-in MCS, CLH and Hemlock queue locks
+// (queue_locks.h), spin-only and -park (spin, then futex), a
+// flat-combining lock (combining.h) that runs critical sections as
+// closures on whichever thread holds it, and a delegation lock
+// (delegation.h) whose server thread runs all of them.  The server is
+// pinned to the last placement slot and is not one of --threads; its CPU
+// time is not in the --cpu and --perf columns.  futex is a bare
+// three-state futex mutex (futex_mutex.h) to hold pthread_mutex_t
+// against; --futex-spin, --futex-wake and --futex-pause set its policy.
+// parking-lot is the one-byte lock of parking_lot.h.  biased is the
+// membarrier-revoked biased lock of biased_lock.h.  pthread-rwlock and
+// std-shared-mutex are both sides of their RW locks, bravo-* puts BRAVO
+// in front of them and rw-percpu / rw-pernode spread the readers over
+// per-CPU / per-node indicators (rw_locks.h).  seqlock-* are sequence
+// locks (seqlock.h) whose writers use the named backend and whose readers
+// read optimistically and retry.
+//
+//   ./lockbench --lock=<name> --threads=<n>[,<n>...] [--iters=<n>] [--cs-work=<n>]
+//               [--nesting=<n>] [--warmup=<n>] [--latency] [--sample=<n>]
+//               [--duration=<sec> [--fairness]] [--placement=<policy>] [--perf] [--cpu]
+//               [--rate=<r>[,<r>...] [--arrival=constant|poisson]] [--cs-ns=<ns>]
+//               [--oversub=<x>[,<x>...] [--preempt-us=<us>]] [--batch=<n>] [--handoff]
+//               [--workload=work|counter|queue|record]
+//               [--futex-spin=<n>] [--futex-wake=one|all] [--futex-pause=pause|yield|none]
+//               [--skew=<pct>] [--bias-after=<n>] [--revoke-after=<n>] [--read-pct=<pct>]
+//   ./lockbench --list
+//
+// Output: lock,threads,nesting,cs_work,seconds,ops/sec
+// A list of thread counts runs each in turn, one line per count.
+// --latency appends acquire-wait and hold percentiles in ns:
+//   wait_p50,wait_p90,wait_p99,wait_p999,wait_max,
+//   hold_p50,hold_p90,hold_p99,hold_p999,hold_max
+// --sample=<n> times only every n-th operation (implies --latency).
+// --duration runs for a fixed time instead of --iters operations.
+// --fairness (needs --duration) appends the spread of per-thread counts:
+//   jain,min_max,min_ops,max_ops,max_wait_ns
+// and prints thread,ops for every thread on stderr.
+// --placement picks the thread-to-CPU policy from placement.h (default
+// compact); the mapping is logged on stderr.
+// --perf appends per-operation perf_event_open counts (perf_counters.h):
+//   cache_misses,llc_misses,ctx_switches,cpu_migrations,page_faults
+// --cpu appends the CPU cost of the timed phase (cpu_usage.h):
+//   cpu_seconds,ops_per_cpu_sec,kernel_share,vol_csw,invol_csw
+// --rate (needs --duration) runs open loop (open_loop.h): every thread
+// offers <r> requests per second, evenly spaced or with poisson gaps, and
+// the response time of each is taken from its scheduled arrival.  A list of
+// rates sweeps the offered load, one line per rate, with the columns
+//   offered_per_sec,resp_p50,resp_p90,resp_p99,resp_p999,resp_max,backlog
+// (ns; backlog is requests still due when the run stopped) after ops/sec.
+// --cs-ns sizes the critical section in nanoseconds instead of --cs-work
+// loop iterations, calibrated at start-up.
+// --oversub runs <x> threads per placement slot instead of --threads (so
+// compact stacks <x> threads on every CPU, one-per-core on every core and
+// none leaves them to the scheduler), one line per factor, with
+//   oversub,holder_preemptions,futex_waits,invol_csw
+// after ops/sec.  A sampled hold longer than --preempt-us (default 20)
+// during which the holding thread's involuntary context switch count went
+// up (read at the start and the end of that hold) counts as a lock-holder
+// preemption; futex_waits are the voluntary switches, i.e.
+// waits that really slept.  Implies --cpu.
+// The NUMA cohort locks (cbo-mcs, hmcs) append
+//   intra_node_handoffs,inter_node_handoffs,intra_ratio
+// right after ops/sec; --batch bounds how many times in a row they hand
+// the lock over within a node (default 64).
+// --handoff appends the hand-over latency, from the holder starting its
+// release to a thread that was already waiting getting the lock, in ns:
+//   handoff_p50,handoff_p90,handoff_p99,handoff_max,handoffs
+// (handoffs is how many were measured).  Every operation is timed for it,
+// --sample does not apply.
+// --workload picks what the critical section touches besides the
+// --cs-work loop: nothing (work, the default), one shared counter
+// (counter), a small shared ring queue, one push and one pop (queue), or
+// a RECORD_WORDS-word record spanning several cache lines that a write
+// fills with the next counter value (record).  All of them check the
+// counter after the run and warn on stderr if increments were lost.
+// --skew (--iters runs only) gives thread 0 <pct> percent of the
+// operations, warmup included, and splits the rest over the others.
+// --read-pct makes that share of the operations reads: the RW backends
+// take them in shared mode and they only look at the --workload data,
+// the other backends run them as ordinary critical sections.  Reads are
+// picked by a per-thread random draw, warmup has none, and --latency,
+// --handoff and --nesting apply to the writes only.  It appends
+//   reads_per_sec,retries_per_read
+// right after ops/sec; retries are the failed validations of optimistic
+// (seqlock) reads.  A record read copies the whole record and checks all
+// words are equal; torn copies are reported on stderr.
+// The biased lock appends
+//   fast_acquires,slow_acquires,revocations,revoke_ns
+// right after ops/sec (revoke_ns is the mean cost of one revocation, the
+// membarrier() and the wait for the owner); --bias-after and
+// --revoke-after set its thresholds (defaults 16 and 8).  The fast path's
+// own cost shows in --latency's wait columns.
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<getopt.h>
+#include<pthread.h>
+#include<sched.h>
+#include<sys/time.h>
+#include<vector>
+
+#include "lock_backends.h"
+#include "lat_hist.h"
+#include "bench_stop.h"
+#include "fairness.h"
+#include "placement.h"
+#include "perf_counters.h"
+#include "cpu_usage.h"
+#include "open_loop.h"
+
+#define NUM_ITERATIONS 1000000000
+#define NUM_WARMUPITERATIONS 10000
+#define MAX_NESTING 64
+#define QUEUE_CAPACITY 64
+#define RECORD_WORDS 32         // --workload=record: four cache lines
+
+// --workload: what the critical section does besides do_work(cs_work)
+enum Workload { WORKLOAD_WORK, WORKLOAD_COUNTER, WORKLOAD_QUEUE, WORKLOAD_RECORD };
+static const char* const workload_names[] = { "work", "counter", "queue", "record" };
+
+struct Options {
+    const char* lock = "pthread";
+    int threads = 1;
+    long long iters = NUM_ITERATIONS;
+    int cs_work = 0;
+    int nesting = 1;
+    long warmup = NUM_WARMUPITERATIONS;
+    bool latency = false;
+    long sample = 1;
+    double duration = 0;    // 0: run --iters operations
+    bool fairness = false;
+    const char* placement = "compact";
+    double rate = 0;        // > 0: open loop, requests per second per thread
+    enum arrival_kind arrival = ARRIVAL_CONSTANT;
+    double tsc_per_ns = 0;
+    int oversub = 0;        // > 0: threads per placement slot
+    uint64_t preempt_ticks = 0;
+    bool handoff = false;
+    Workload workload = WORKLOAD_WORK;
+    double skew = 0;        // > 0: thread 0's percentage of the operations
+    double read_pct = -1;   // >= 0: percentage of the operations that are reads
+};
+
+// Per-thread histograms, one cache-line-aligned slot per worker
+struct alignas(64) LatSlot {
+    struct lat_hist wait;
+    struct lat_hist hold;
+    struct lat_hist resp;   // open loop: scheduled arrival to release
+    struct lat_hist handoff;
+    uint64_t backlog;
+    uint64_t preempted;     // --oversub: holds cut by an involuntary switch
+};
+
+// Intra-/inter-node hand-overs of the last run, summed over the workers;
+// only the NUMA cohort locks (numa_locks.h) count them
+static struct {
+    bool valid;
+    uint64_t intra, inter;
+} handoffs;
+
+// --read-pct reads of the last run, summed over the workers
+static struct {
+    uint64_t ops, retries, torn;
+} read_stats;
+
+// Fast-path and revoking acquisitions of the last run, summed over the
+// workers; only the biased lock (biased_lock.h) counts them
+static struct {
+    bool valid;
+    uint64_t fast, slow, revocations, revoke_ns;
+} bias_stats;
+
+// --handoff: when and by whom the lock was last released, written by
+// the holder
+static struct alignas(64) {
+    uint64_t release;
+    long owner;
+} handoff_mark;
+
+pthread_barrier_t my_barrier;
+struct timeval timeStart, timeEnd;
+
+// Pin the calling thread according to --placement (placement.h)
+void set_cpu_affinity(int thread_index) {
+    placement_pin(thread_index);
+}
+
+// Simulated work inside the critical section
+static inline void do_work(int amount) {
+    volatile int dummy = 0;
+    for (int i = 0; i < amount; i++) {
+        dummy += i;
+    }
+}
+
+template <class L>
+struct Worker {
+    L* lock;
+    const Options* opt;
+    long thread_index;
+    LatSlot* lat;
+    uint64_t* ops;
+    struct perf_group* perf;
+    struct cpu_usage* cpu;
+};
+
+// The data the counter, queue and record workloads protect
+static struct alignas(64) {
+    uint64_t counter;               // one increment per critical section
+    uint64_t dequeued;
+    unsigned head, tail;            // the queue holds tail - head items
+    uint64_t ring[QUEUE_CAPACITY];
+    alignas(64) uint64_t record[RECORD_WORDS];
+} shared;
+
+static void shared_reset() {
+    shared.counter = 0;
+    shared.head = 0;
+    shared.tail = QUEUE_CAPACITY / 2;
+    for (int i = 0; i < RECORD_WORDS; i++)
+        shared.record[i] = 0;
+}
+
+// What runs under the lock
+static inline void cs_body(int cs_work, Workload workload) {
+    if (workload == WORKLOAD_COUNTER) {
+        shared.counter++;
+    } else if (workload == WORKLOAD_QUEUE) {
+        // one enqueue and one dequeue, so the queue stays half full
+        shared.ring[shared.tail++ % QUEUE_CAPACITY] = shared.counter++;
+        shared.dequeued = shared.ring[shared.head++ % QUEUE_CAPACITY];
+    } else if (workload == WORKLOAD_RECORD) {
+        // relaxed atomics: optimistic readers may be copying it meanwhile
+        uint64_t v = ++shared.counter;
+        for (int i = 0; i < RECORD_WORDS; i++)
+            __atomic_store_n(&shared.record[i], v, __ATOMIC_RELAXED);
+    }
+    do_work(cs_work);
+}
+
+// This thread's part of `total` operations: an even split, or with --skew
+// <pct> percent for thread 0 and an even split of the rest for the others
+static long long thread_share(long long total, double skew, int index, int threads) {
+    if (skew > 0 && threads > 1) {
+        long long first = (long long)(total * skew / 100);
+        if (index == 0)
+            return first;
+        total -= first;
+        index--;
+        threads--;
+    }
+    return total / threads + (index < total % threads);
+}
+
+// What a --read-pct read does: look at the data, change nothing; a
+// record read copies the record to `copy`
+static inline void cs_read_body(int cs_work, Workload workload, uint64_t* copy) {
+    if (workload == WORKLOAD_COUNTER) {
+        volatile uint64_t v = shared.counter;
+        (void)v;
+    } else if (workload == WORKLOAD_QUEUE) {
+        volatile uint64_t v = shared.ring[shared.head % QUEUE_CAPACITY];
+        (void)v;
+    } else if (workload == WORKLOAD_RECORD) {
+        for (int i = 0; i < RECORD_WORDS; i++)
+            copy[i] = __atomic_load_n(&shared.record[i], __ATOMIC_RELAXED);
+    }
+    do_work(cs_work);
+}
+
+// Run body with the lock held: `nesting` lock() calls deep for the
+// reentrant backends, through execute_under_lock() otherwise
+template <class L, class F>
+static inline void with_lock(L& lock, int nesting, F&& body) {
+    if constexpr (L::reentrant) {
+        if (nesting > 1) {
+            for (int j = 0; j < nesting; j++)
+                lock.lock();
+            body();
+            for (int j = 0; j < nesting; j++)
+                lock.unlock();
+            return;
+        }
+    }
+    execute_under_lock(lock, body);
+}
+
+// One critical section
+template <class L>
+static inline void critical_section(L& lock, int nesting, int cs_work, Workload workload) {
+    with_lock(lock, nesting, [&] { cs_body(cs_work, workload); });
+}
+
+// One read; returns 1 if it saw a torn record
+template <class L>
+static inline int read_critical_section(L& lock, int cs_work, Workload workload) {
+    uint64_t copy[RECORD_WORDS];
+    execute_shared(lock, [&] { cs_read_body(cs_work, workload, copy); });
+    if (workload == WORKLOAD_RECORD)
+        for (int i = 1; i < RECORD_WORDS; i++)
+            if (copy[i] != copy[0])
+                return 1;
+    return 0;
+}
+
+// Involuntary context switches of the calling thread so far
+static inline long thread_ivcsw() {
+    struct rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    return ru.ru_nivcsw;
+}
+
+// With preempt_ticks > 0, inside the critical section: count the hold as
+// a lock-holder preemption if it took longer than that and the thread
+// that ran it was switched out since `ivcsw0`
+static inline void check_holder_preempted(LatSlot* lat, uint64_t preempt_ticks, uint64_t hold, long ivcsw0) {
+    if (hold > preempt_ticks && thread_ivcsw() > ivcsw0)
+        lat->preempted++;
+}
+
+// Same, timing the acquire (call to the critical section starting) and
+// the hold (the critical section itself); returns the hold.
+template <class L>
+static inline uint64_t timed_critical_section(L& lock, int nesting, int cs_work, Workload workload,
+                                              LatSlot* lat, uint64_t preempt_ticks) {
+    uint64_t t0 = lat_now(), t1 = 0, t2 = 0;
+    with_lock(lock, nesting, [&] {
+        long ivcsw0 = preempt_ticks > 0 ? thread_ivcsw() : 0;
+        t1 = lat_now();
+        cs_body(cs_work, workload);
+        t2 = lat_now();
+        if (preempt_ticks > 0)
+            check_holder_preempted(lat, preempt_ticks, t2 - t1, ivcsw0);
+    });
+    lat_hist_record(&lat->wait, t1 - t0);
+    lat_hist_record(&lat->hold, t2 - t1);
+    return t2 - t1;
+}
+
+// Same for --handoff, which also records how long after the previous
+// holder began releasing this thread got the lock, if it was already
+// waiting then
+template <class L>
+static inline uint64_t handoff_critical_section(L& lock, int nesting, int cs_work, Workload workload,
+                                                LatSlot* lat, long self, uint64_t preempt_ticks) {
+    uint64_t t0 = lat_now(), t1 = 0, t2 = 0;
+    with_lock(lock, nesting, [&] {
+        long ivcsw0 = preempt_ticks > 0 ? thread_ivcsw() : 0;
+        t1 = lat_now();
+        if (handoff_mark.owner != self && handoff_mark.release > t0)
+            lat_hist_record(&lat->handoff, t1 - handoff_mark.release);
+        cs_body(cs_work, workload);
+        t2 = lat_now();
+        handoff_mark.owner = self;
+        handoff_mark.release = t2;
+        if (preempt_ticks > 0)
+            check_holder_preempted(lat, preempt_ticks, t2 - t1, ivcsw0);
+    });
+    lat_hist_record(&lat->wait, t1 - t0);
+    lat_hist_record(&lat->hold, t2 - t1);
+    return t2 - t1;
+}
+
+// Timed is a template parameter so the untimed loop carries no sampling
+// branch at all.
+template <class L, bool Timed>
+void* mainThreadFunction(void* arg) {
+    Worker<L>* w = (Worker<L>*)arg;
+    L& lock = *w->lock;
+    const int nesting = w->opt->nesting;
+    const int cs_work = w->opt->cs_work;
+    const Workload workload = w->opt->workload;
+    set_cpu_affinity(w->thread_index);
+    perf_group_open(w->perf);
+
+    long long iterations_per_thread = thread_share(w->opt->iters, w->opt->skew, w->thread_index, w->opt->threads);
+    long long warmup = thread_share(w->opt->warmup * w->opt->threads, w->opt->skew, w->thread_index, w->opt->threads);
+
+    for (long long i = 0; i < warmup; i++)
+        critical_section(lock, nesting, cs_work, workload);
+
+    pthread_barrier_wait(&my_barrier);
+    if(w->thread_index == 0) {
+        gettimeofday(&timeStart, 0);
+        if (w->opt->duration > 0)
+            bench_stop_start(w->opt->duration);
+    }
+    perf_group_start(w->perf);
+    cpu_usage_start(w->cpu);
+    const uint64_t intra0 = numa_intra_handoffs, inter0 = numa_inter_handoffs;
+    const uint64_t fast0 = biased_fast_acquires, slow0 = biased_slow_acquires;
+    const uint64_t revocations0 = biased_revocations, revoke_ns0 = biased_revoke_ns;
+
+    const long sample = w->opt->sample;
+    const uint64_t preempt_ticks = w->opt->preempt_ticks;
+    long countdown = sample;
+    const bool handoff = w->opt->handoff;
+    const bool reads = w->opt->read_pct >= 0;
+    const uint32_t read_below = (uint32_t)(w->opt->read_pct / 100 * 4294967295.0);
+    uint32_t draw = w->thread_index * 2654435761u + 1;
+    long long nreads = 0, ntorn = 0;
+    const uint64_t retries0 = seq_read_retries;
+    auto op = [&]() {
+        if (reads) {
+            draw ^= draw << 13;     // xorshift32, never 0
+            draw ^= draw >> 17;
+            draw ^= draw << 5;
+            if (draw <= read_below) {
+                ntorn += read_critical_section(lock, cs_work, workload);
+                nreads++;
+                return;
+            }
+        }
+        if (Timed && (handoff || --countdown == 0)) {
+            countdown = sample;
+            if (handoff)
+                handoff_critical_section(lock, nesting, cs_work, workload, w->lat, w->thread_index, preempt_ticks);
+            else
+                timed_critical_section(lock, nesting, cs_work, workload, w->lat, preempt_ticks);
+        } else {
+            critical_section(lock, nesting, cs_work, workload);
+        }
+    };
+
+    long long ops = 0;
+    if (w->opt->rate > 0) {
+        struct arrival a;
+        arrival_init(&a, lat_now(), w->opt->rate, w->opt->tsc_per_ns, w->opt->arrival,
+                     w->thread_index, w->opt->threads);
+        while (!bench_should_stop()) {
+            uint64_t due = arrival_wait(&a);
+            op();
+            lat_hist_record(&w->lat->resp, lat_now() - due);
+            ops++;
+        }
+        w->lat->backlog = arrival_backlog(&a, lat_now());
+    } else if (w->opt->duration > 0) {
+        while (!bench_should_stop()) {
+            op();
+            ops++;
+        }
+    } else {
+        for (; ops < iterations_per_thread; ops++)
+            op();
+    }
+    perf_group_stop(w->perf);
+    cpu_usage_stop(w->cpu);
+    *w->ops = ops;
+    __atomic_add_fetch(&handoffs.intra, numa_intra_handoffs - intra0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&handoffs.inter, numa_inter_handoffs - inter0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&read_stats.ops, nreads, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&read_stats.retries, seq_read_retries - retries0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&read_stats.torn, ntorn, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bias_stats.fast, biased_fast_acquires - fast0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bias_stats.slow, biased_slow_acquires - slow0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bias_stats.revocations, biased_revocations - revocations0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bias_stats.revoke_ns, biased_revoke_ns - revoke_ns0, __ATOMIC_RELAXED);
+
+    pthread_barrier_wait(&my_barrier);
+    if(w->thread_index == 0)
+        gettimeofday(&timeEnd, 0);
+    return NULL;
+}
+
+// The backends whose lock() keeps numa_{intra,inter}_handoffs
+template <class L>
+static bool counts_handoffs(const L&) { return false; }
+static bool counts_handoffs(const CboMcsLock&) { return true; }
+static bool counts_handoffs(const HmcsLock&) { return true; }
+
+template <class L>
+static bool counts_bias(const L&) { return false; }
+static bool counts_bias(const BiasedLock&) { return true; }
+
+template <class L>
+double run_backend(const Options& opt, LatSlot* lat, uint64_t* ops, struct perf_group* perf,
+                   struct cpu_usage* cpu_use) {
+    L lock;
+    int numWorkers = opt.threads;
+    pthread_t Threads[numWorkers];
+    Worker<L> workers[numWorkers];
+    pthread_barrier_init(&my_barrier, NULL, numWorkers);
+    handoffs.intra = handoffs.inter = 0;
+    read_stats.ops = read_stats.retries = read_stats.torn = 0;
+    bias_stats.fast = bias_stats.slow = bias_stats.revocations = bias_stats.revoke_ns = 0;
+    handoff_mark.release = 0;
+    handoff_mark.owner = -1;
+    shared_reset();
+    bench_stop_reset();
+
+    for (int i = 0; i < numWorkers; i++) {
+        workers[i].lock = &lock;
+        workers[i].opt = &opt;
+        workers[i].thread_index = i;
+        workers[i].lat = lat ? &lat[i] : NULL;
+        workers[i].ops = &ops[i];
+        workers[i].perf = &perf[i];
+        workers[i].cpu = &cpu_use[i];
+        pthread_create(&Threads[i], NULL,
+                       opt.latency || opt.fairness || opt.oversub || opt.handoff
+                           ? mainThreadFunction<L, true> : mainThreadFunction<L, false>,
+                       &workers[i]);
+    }
+    for (int i = 0; i < numWorkers; i++) {
+        pthread_join(Threads[i], NULL);
+    }
+    bench_stop_join();
+    pthread_barrier_destroy(&my_barrier);
+    handoffs.valid = counts_handoffs(lock);
+    bias_stats.valid = counts_bias(lock);
+
+    long long elapsed = (timeEnd.tv_sec-timeStart.tv_sec)*1000000LL + timeEnd.tv_usec-timeStart.tv_usec;
+    return elapsed/(double)1000000;
+}
+
+struct Backend {
+    const char* name;
+    const char* legacy;   // the build it replaces
+    bool reentrant;
+    double (*run)(const Options&, LatSlot*, uint64_t*, struct perf_group*, struct cpu_usage*);
+};
+
+#define BACKEND(name, legacy, ...) { name, legacy, __VA_ARGS__::reentrant, run_backend<__VA_ARGS__> }
+
+static const Backend backends[] = {
+    BACKEND("pthread",            "pthread_benchmark_normal",          PthreadMutex<PTHREAD_MUTEX_NORMAL>),
+    BACKEND("pthread-recursive",  "pthread_benchmark_reentrant",       PthreadMutex<PTHREAD_MUTEX_RECURSIVE>),
+    BACKEND("pthread-errorcheck", "pthread_benchmark_errorcheck",      PthreadMutex<PTHREAD_MUTEX_ERRORCHECK>),
+    BACKEND("pthread-shield",     "pthread_benchmark_shield_array_re", Shielded<PthreadMutex<PTHREAD_MUTEX_NORMAL>, false>),
+    BACKEND("pthread-shield-re",  "-",                                 Shielded<PthreadMutex<PTHREAD_MUTEX_NORMAL>, true>),
+    BACKEND("pthread-rwlock-rd",  "pthread_benchmark_rwlock",          PthreadRwlockRead),
+    BACKEND("std",                "mutex_bench",                       StdLock<std::mutex, false>),
+    BACKEND("std-recursive",      "mutex_bench_recur",                 StdLock<std::recursive_mutex, true>),
+    BACKEND("std-shield",         "mutex_bench_shield",                Shielded<StdLock<std::mutex, false>, false>),
+    BACKEND("std-shared",         "mutex_bench_rw",                    StdSharedRead),
+    BACKEND("mcs",                "litl libmcs_spinlock.sh",           McsLock<false>),
+    BACKEND("mcs-park",           "-",                                 McsLock<true>),
+    BACKEND("mcs-shield-re",      "-",                                 Shielded<McsLock<false>, true>),
+    BACKEND("clh",                "-",                                 ClhLock<false>),
+    BACKEND("clh-park",           "-",                                 ClhLock<true>),
+    BACKEND("clh-shield-re",      "-",                                 Shielded<ClhLock<false>, true>),
+    BACKEND("hemlock",            "-",                                 Hemlock<false>),
+    BACKEND("hemlock-park",       "-",                                 Hemlock<true>),
+    BACKEND("hemlock-shield-re",  "-",                                 Shielded<Hemlock<false>, true>),
+    BACKEND("cbo-mcs",            "-",                                 CboMcsLock),
+    BACKEND("hmcs",               "-",                                 HmcsLock),
+    BACKEND("ticket",             "-",                                 TicketLock),
+    BACKEND("ticket-partitioned", "-",                                 PartitionedTicketLock),
+    BACKEND("twa",                "-",                                 TwaLock),
+    BACKEND("futex",              "-",                                 FutexMutex),
+    BACKEND("futex-shield-re",    "-",                                 Shielded<FutexMutex, true>),
+    BACKEND("parking-lot",        "-",                                 ParkingLotLock),
+    BACKEND("biased",             "-",                                 BiasedLock),
+    BACKEND("pthread-rwlock",     "-",                                 PthreadRwlock),
+    BACKEND("std-shared-mutex",   "-",                                 StdSharedMutex),
+    BACKEND("bravo-pthread-rwlock", "-",                               Bravo<PthreadRwlock>),
+    BACKEND("bravo-std-shared",   "-",                                 Bravo<StdSharedMutex>),
+    BACKEND("rw-percpu",          "-",                                 DistributedRw<DRW_PER_CPU>),
+    BACKEND("rw-pernode",         "-",                                 DistributedRw<DRW_PER_NODE>),
+    BACKEND("seqlock-pthread",    "-",                                 Seqlock<PthreadMutex<PTHREAD_MUTEX_NORMAL>>),
+    BACKEND("seqlock-futex",      "-",                                 Seqlock<FutexMutex>),
+    BACKEND("seqlock-mcs",        "-",                                 Seqlock<McsLock<true>>),
+    BACKEND("flat-combining",     "-",                                 FlatCombining),
+    BACKEND("delegation",         "-",                                 DelegationLock),
+#ifdef _OPENMP
+    BACKEND("omp",                "omp_bench",                         OmpLock),
+    BACKEND("omp-nested",         "omp_bench_nested",                  OmpNestLock),
+#endif
+#ifdef LOCKBENCH_HAVE_BOOST
+    BACKEND("boost",              "boost_bench",                       StdLock<boost::mutex, false>),
+    BACKEND("boost-recursive",    "boost_bench -DRECURSIVE",           StdLock<boost::recursive_mutex, true>),
+#endif
+};
+
+#define NUM_BACKENDS (int)(sizeof(backends) / sizeof(backends[0]))
+
+static const Backend* find_backend(const char* name) {
+    for (int i = 0; i < NUM_BACKENDS; i++)
+        if (strcmp(backends[i].name, name) == 0)
+            return &backends[i];
+    return NULL;
+}
+
+static void list_backends() {
+    printf("%-20s %-10s %s\n", "lock", "nestable", "replaces");
+    for (int i = 0; i < NUM_BACKENDS; i++)
+        printf("%-20s %-10s %s\n", backends[i].name,
+               backends[i].reentrant ? "yes" : "no", backends[i].legacy);
+}
+
+static void usage(const char* exe) {
+    printf("usage: %s --lock=<name> --threads=<n>[,<n>...] [--iters=<n>] [--cs-work=<n>]"
+           " [--nesting=<n>] [--warmup=<n>] [--latency] [--sample=<n>]"
+           " [--duration=<sec> [--fairness]] [--placement=<policy>] [--perf] [--cpu]"
+           " [--rate=<r>[,<r>...] [--arrival=constant|poisson]] [--cs-ns=<ns>]"
+           " [--oversub=<x>[,<x>...] [--preempt-us=<us>]] [--batch=<n>] [--handoff]"
+           " [--workload=work|counter|queue|record]"
+           " [--futex-spin=<n>] [--futex-wake=one|all] [--futex-pause=pause|yield|none]"
+           " [--skew=<pct>] [--bias-after=<n>] [--revoke-after=<n>] [--read-pct=<pct>] | --list\n", exe);
+}
+
+// Merge the per-thread histograms and print percentiles as extra columns
+static void print_latency(const LatSlot* lat, int threads) {
+    static const double q[] = { 0.50, 0.90, 0.99, 0.999 };
+    static struct lat_hist wait, hold;
+    lat_hist_init(&wait);
+    lat_hist_init(&hold);
+    for (int i = 0; i < threads; i++) {
+        lat_hist_merge(&wait, &lat[i].wait);
+        lat_hist_merge(&hold, &lat[i].hold);
+    }
+    double tpns = lat_tsc_per_ns();
+    const struct lat_hist* h[] = { &wait, &hold };
+    for (int k = 0; k < 2; k++) {
+        for (int j = 0; j < 4; j++)
+            printf(",%.1f", lat_hist_quantile(h[k], q[j]) / tpns);
+        printf(",%.1f", h[k]->max / tpns);
+    }
+}
+
+// Hand-over latency percentiles in ns and how many were seen
+static void print_handoff(const LatSlot* lat, int threads) {
+    static const double q[] = { 0.50, 0.90, 0.99 };
+    static struct lat_hist h;
+    lat_hist_init(&h);
+    for (int i = 0; i < threads; i++)
+        lat_hist_merge(&h, &lat[i].handoff);
+    double tpns = lat_tsc_per_ns();
+    for (int j = 0; j < 3; j++)
+        printf(",%.1f", lat_hist_quantile(&h, q[j]) / tpns);
+    printf(",%.1f,%llu", h.max / tpns, (unsigned long long)h.count);
+}
+
+// Offered load, response-time percentiles in ns and the leftover backlog
+static void print_open_loop(const LatSlot* lat, const Options& opt) {
+    static const double q[] = { 0.50, 0.90, 0.99, 0.999 };
+    static struct lat_hist resp;
+    uint64_t backlog = 0;
+    lat_hist_init(&resp);
+    for (int i = 0; i < opt.threads; i++) {
+        lat_hist_merge(&resp, &lat[i].resp);
+        backlog += lat[i].backlog;
+    }
+    printf(",%f", opt.rate * opt.threads);
+    for (int j = 0; j < 4; j++)
+        printf(",%.1f", lat_hist_quantile(&resp, q[j]) / opt.tsc_per_ns);
+    printf(",%.1f,%llu", resp.max / opt.tsc_per_ns, (unsigned long long)backlog);
+}
+
+// Stacking factor, inferred lock-holder preemptions, sleeping waits and
+// all involuntary switches
+static void print_oversub(const LatSlot* lat, const struct cpu_usage* cpu_use, const Options& opt) {
+    uint64_t preempted = 0;
+    long vol = 0, invol = 0;
+    for (int i = 0; i < opt.threads; i++) {
+        preempted += lat[i].preempted;
+        vol += cpu_use[i].vol_csw;
+        invol += cpu_use[i].invol_csw;
+    }
+    printf(",%d,%llu,%ld,%ld", opt.oversub, (unsigned long long)preempted, vol, invol);
+}
+
+// Comma-separated positive numbers; whole numbers >= 1 with `whole`
+static bool parse_list(const char* arg, std::vector<double>* out, bool whole = false) {
+    for (const char* p = arg; *p; p += *p == ',') {
+        char* end;
+        out->push_back(strtod(p, &end));
+        double v = out->back();
+        if (end == p || v <= 0 || (whole && (v < 1 || v > INT_MAX || v != (int)v)))
+            return false;
+        p = end;
+    }
+    return !out->empty();
+}
+
+// do_work() iterations that take `ns` nanoseconds on this machine
+static int calibrate_cs_work(double ns, double tsc_per_ns) {
+    const int probe = 1 << 20;
+    uint64_t best = UINT64_MAX;
+    for (int k = 0; k < 5; k++) {
+        uint64_t t0 = lat_now();
+        do_work(probe);
+        uint64_t t = lat_now() - t0;
+        if (t < best)
+            best = t;
+    }
+    double ns_per_iter = best / tsc_per_ns / probe;
+    return (int)(ns / ns_per_iter + 0.5);
+}
+
+// Per-thread counts on stderr, summary columns on the CSV line
+static void print_fairness(const uint64_t* ops, const LatSlot* lat, int threads) {
+    uint64_t max_wait = 0;
+    for (int i = 0; i < threads; i++) {
+        fprintf(stderr, "%d,%llu\n", i, (unsigned long long)ops[i]);
+        if (lat[i].wait.max > max_wait)
+            max_wait = lat[i].wait.max;
+    }
+    struct fairness f = fairness_compute(ops, threads);
+    printf(",%f,%f,%llu,%llu,%.1f", f.jain, f.min_max, (unsigned long long)f.min_ops,
+           (unsigned long long)f.max_ops, max_wait / lat_tsc_per_ns());
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"lock",    required_argument, 0, 'l'},
+        {"threads", required_argument, 0, 't'},
+        {"iters",   required_argument, 0, 'i'},
+        {"cs-work", required_argument, 0, 'w'},
+        {"nesting", required_argument, 0, 'n'},
+        {"warmup",  required_argument, 0, 'W'},
+        {"latency", no_argument,       0, 'T'},
+        {"sample",  required_argument, 0, 's'},
+        {"duration", required_argument, 0, 'd'},
+        {"fairness", no_argument,      0, 'F'},
+        {"placement", required_argument, 0, 'P'},
+        {"perf",    no_argument,       0, 'p'},
+        {"cpu",     no_argument,       0, 'C'},
+        {"rate",    required_argument, 0, 'r'},
+        {"arrival", required_argument, 0, 'a'},
+        {"cs-ns",   required_argument, 0, 'N'},
+        {"oversub", required_argument, 0, 'o'},
+        {"preempt-us", required_argument, 0, 'u'},
+        {"batch",   required_argument, 0, 'B'},
+        {"handoff", no_argument,       0, 'H'},
+        {"workload", required_argument, 0, 'k'},
+        {"skew",    required_argument, 0, 'S'},
+        {"read-pct", required_argument, 0, 'x'},
+        {"bias-after", required_argument, 0, 'b'},
+        {"revoke-after", required_argument, 0, 'R'},
+        {"list",    no_argument,       0, 'L'},
+        {"help",    no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    Options opt;
+    std::vector<double> rates, oversub, thread_counts;
+    const char* arrival = "constant";
+    const char* workload = "work";
+    double preempt_us = 20;
+    double cs_ns = -1;
+    int c;
+    futex_mutex_parse(&argc, argv);
+    while ((c = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        switch (c) {
+        case 'l': opt.lock = optarg; break;
+        case 't':
+            if (!parse_list(optarg, &thread_counts, true)) {
+                fprintf(stderr, "Error: bad --threads list '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'i': opt.iters = atoll(optarg); break;
+        case 'w': opt.cs_work = atoi(optarg); break;
+        case 'n': opt.nesting = atoi(optarg); break;
+        case 'W': opt.warmup = atol(optarg); break;
+        case 'T': opt.latency = true; break;
+        case 's': opt.sample = atol(optarg); opt.latency = true; break;
+        case 'd': opt.duration = atof(optarg); break;
+        case 'F': opt.fairness = true; break;
+        case 'P': opt.placement = optarg; break;
+        case 'p': perf_counters_enabled = 1; break;
+        case 'C': cpu_usage_enabled = 1; break;
+        case 'r':
+            if (!parse_list(optarg, &rates)) {
+                fprintf(stderr, "Error: bad --rate list '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'o':
+            if (!parse_list(optarg, &oversub, true)) {
+                fprintf(stderr, "Error: bad --oversub list '%s'\n", optarg);
+                return 1;
+            }
+            cpu_usage_enabled = 1;
+            break;
+        case 'u': preempt_us = atof(optarg); break;
+        case 'B': numa_lock_batch = atoi(optarg); break;
+        case 'H': opt.handoff = true; break;
+        case 'k': workload = optarg; break;
+        case 'S': opt.skew = atof(optarg); break;
+        case 'x': opt.read_pct = atof(optarg); break;
+        case 'b': biased_bias_after = atoi(optarg); break;
+        case 'R': biased_revoke_after = atoi(optarg); break;
+        case 'a': arrival = optarg; break;
+        case 'N': cs_ns = atof(optarg); break;
+        case 'L': list_backends(); return 0;
+        default:  usage(argv[0]); return c == 'h' ? 0 : 1;
+        }
+    }
+
+    const Backend* b = find_backend(opt.lock);
+    if (!b) {
+        fprintf(stderr, "Error: unknown lock '%s' (see --list)\n", opt.lock);
+        return 1;
+    }
+    if (opt.threads <= 0 || opt.iters <= 0 || opt.cs_work < 0 || opt.warmup < 0 || opt.sample <= 0 || opt.duration < 0 ||
+        opt.nesting <= 0 || opt.nesting > MAX_NESTING || numa_lock_batch < 0) {
+        fprintf(stderr, "Error: need threads > 0, iters > 0, cs-work >= 0, sample > 0, 1-%d nesting, batch >= 0\n", MAX_NESTING);
+        return 1;
+    }
+    if (placement_init(opt.placement) != 0) {
+        fprintf(stderr, "Error: unknown placement '%s' (compact, scatter, smt-pairs, "
+                "one-per-core, per-numa-node, none)\n", opt.placement);
+        return 1;
+    }
+    if (opt.fairness && opt.duration <= 0) {
+        fprintf(stderr, "Error: --fairness needs a fixed --duration\n");
+        return 1;
+    }
+    if (opt.nesting > 1 && !b->reentrant) {
+        fprintf(stderr, "Error: lock '%s' cannot be nested\n", b->name);
+        return 1;
+    }
+    if (opt.skew < 0 || opt.skew > 100 || (opt.skew > 0 && opt.duration > 0) ||
+        biased_bias_after < 1 || biased_revoke_after < 1) {
+        fprintf(stderr, "Error: need --skew 0-100 without --duration, bias-after and revoke-after >= 1\n");
+        return 1;
+    }
+    if (opt.read_pct > 100) {
+        fprintf(stderr, "Error: --read-pct is at most 100\n");
+        return 1;
+    }
+    if (opt.read_pct >= 0)
+        fprintf(stderr, "# read-pct=%g\n", opt.read_pct);
+    if (!rates.empty() && opt.duration <= 0) {
+        fprintf(stderr, "Error: --rate needs a fixed --duration\n");
+        return 1;
+    }
+    if (strcmp(arrival, "constant") == 0) {
+        opt.arrival = ARRIVAL_CONSTANT;
+    } else if (strcmp(arrival, "poisson") == 0) {
+        opt.arrival = ARRIVAL_POISSON;
+    } else {
+        fprintf(stderr, "Error: unknown arrival '%s' (constant, poisson)\n", arrival);
+        return 1;
+    }
+    int k = 0;
+    while (k < (int)(sizeof(workload_names) / sizeof(workload_names[0])) && strcmp(workload, workload_names[k]) != 0)
+        k++;
+    if (k == (int)(sizeof(workload_names) / sizeof(workload_names[0]))) {
+        fprintf(stderr, "Error: unknown workload '%s' (work, counter, queue, record)\n", workload);
+        return 1;
+    }
+    opt.workload = (Workload)k;
+    if (opt.workload != WORKLOAD_WORK)
+        fprintf(stderr, "# workload=%s\n", workload_names[k]);
+    if (!rates.empty() || cs_ns >= 0 || !oversub.empty())
+        opt.tsc_per_ns = lat_tsc_per_ns();
+    opt.preempt_ticks = (uint64_t)(preempt_us * 1000 * opt.tsc_per_ns);
+    if (cs_ns >= 0) {
+        opt.cs_work = calibrate_cs_work(cs_ns, opt.tsc_per_ns);
+        fprintf(stderr, "# cs-ns=%.0f cs-work=%d\n", cs_ns, opt.cs_work);
+    }
+    if (rates.empty())
+        rates.push_back(0);     // closed loop
+    if (oversub.empty())
+        oversub.push_back(0);   // --threads as given
+    if (thread_counts.empty())
+        thread_counts.push_back(1);
+
+    for (double nthreads : thread_counts)
+    for (double factor : oversub)
+    for (double rate : rates) {
+        opt.rate = rate;
+        opt.oversub = (int)factor;
+        opt.threads = opt.oversub > 0 ? opt.oversub * placement.nslots : (int)nthreads;
+        // the longest wait for --fairness comes from the wait histograms,
+        // open-loop response times from resp
+        LatSlot* lat = opt.latency || opt.fairness || opt.rate > 0 || opt.oversub || opt.handoff
+                           ? new LatSlot[opt.threads] : NULL;
+        uint64_t* ops = new uint64_t[opt.threads];
+        struct perf_group* perf = new perf_group[opt.threads];
+        struct cpu_usage* cpu_use = new cpu_usage[opt.threads];
+        if (rate == rates[0])
+            placement_log(stderr, opt.threads);
+
+        for (int i = 0; lat && i < opt.threads; i++) {
+            lat_hist_init(&lat[i].wait);
+            lat_hist_init(&lat[i].hold);
+            lat_hist_init(&lat[i].resp);
+            lat_hist_init(&lat[i].handoff);
+            lat[i].backlog = 0;
+            lat[i].preempted = 0;
+        }
+        double seconds = b->run(opt, lat, ops, perf, cpu_use);
+        long long total_ops = 0;
+        for (int i = 0; i < opt.threads; i++)
+            total_ops += ops[i];
+        if (opt.workload != WORKLOAD_WORK &&
+            shared.counter != (uint64_t)(total_ops - read_stats.ops + opt.warmup * opt.threads))
+            fprintf(stderr, "# %s: counter=%llu, expected %llu: lost updates\n", b->name,
+                    (unsigned long long)shared.counter,
+                    (unsigned long long)(total_ops - read_stats.ops + opt.warmup * opt.threads));
+        if (read_stats.torn)
+            fprintf(stderr, "# %s: %llu torn record reads\n", b->name, (unsigned long long)read_stats.torn);
+        printf("%s,%d,%d,%d,%f,%f", b->name, opt.threads, opt.nesting, opt.cs_work,
+               seconds, total_ops/seconds);
+        if (handoffs.valid)
+            printf(",%llu,%llu,%f", (unsigned long long)handoffs.intra, (unsigned long long)handoffs.inter,
+                   handoffs.intra + handoffs.inter ? (double)handoffs.intra / (handoffs.intra + handoffs.inter) : 0.0);
+        if (bias_stats.valid)
+            printf(",%llu,%llu,%llu,%.1f", (unsigned long long)bias_stats.fast, (unsigned long long)bias_stats.slow,
+                   (unsigned long long)bias_stats.revocations,
+                   bias_stats.revocations ? (double)bias_stats.revoke_ns / bias_stats.revocations : 0.0);
+        if (opt.read_pct >= 0)
+            printf(",%f,%f", read_stats.ops / seconds,
+                   read_stats.ops ? (double)read_stats.retries / read_stats.ops : 0.0);
+        if (opt.rate > 0)
+            print_open_loop(lat, opt);
+        if (opt.oversub > 0)
+            print_oversub(lat, cpu_use, opt);
+        if (opt.handoff)
+            print_handoff(lat, opt.threads);
+        if (opt.latency)
+            print_latency(lat, opt.threads);
+        if (opt.fairness)
+            print_fairness(ops, lat, opt.threads);
+        perf_print_columns(stdout, perf, opt.threads, total_ops);
+        cpu_usage_print_columns(stdout, cpu_use, opt.threads, total_ops);
+        printf("\n");
+        fflush(stdout);
+        delete[] cpu_use;
+        delete[] perf;
+        delete[] ops;
+        delete[] lat;
+    }
+    return 0;
+}
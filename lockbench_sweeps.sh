@@ -0,0 +1,104 @@
+#!/bin/bash
+# lockbench comparisons, one sweep per name:
+#   ./lockbench_sweeps.sh                  every sweep
+#   ./lockbench_sweeps.sh futex biased     only those
+# openloop oversub numa handoff combining futex biased rw seqlock
+pwd; hostname; date
+g++ -O3 -std=c++17 lockbench.cpp -o lockbench -lpthread -fopenmp
+mkdir -p results
+
+sweeps=${*:-openloop oversub numa handoff combining futex biased rw seqlock}
+
+for i in {1..10}
+	do
+	for sweep in $sweeps
+		do
+		case $sweep in
+		openloop)
+			# offered-load sweep: the saturation point is where ops/sec stops following offered_per_sec and resp_p99 / backlog take off
+			for lock in pthread std omp
+				do
+				./lockbench --lock=$lock --threads=64 --cs-ns=200 --duration=5 --arrival=poisson --rate=1000,5000,10000,20000,50000,100000,200000 >>results/lockbench_${lock}_openloop64.csv
+				done
+			;;
+		oversub)
+			# 1x-8x threads per CPU, pinned and left to the scheduler: oversub,holder_preemptions,futex_waits,invol_csw after ops/sec
+			for lock in pthread pthread-recursive std omp
+				do
+				./lockbench --lock=$lock --oversub=1,2,4,8 --duration=5 --cs-work=100 >>results/lockbench_${lock}_oversub.csv
+				./lockbench --lock=$lock --oversub=1,2,4,8 --duration=5 --cs-work=100 --placement=none >>results/lockbench_${lock}_oversub_unpinned.csv
+				done
+			;;
+		numa)
+			# threads dealt over both sockets; the cohort locks add intra_node_handoffs,inter_node_handoffs,intra_ratio after ops/sec
+			for lock in pthread mcs cbo-mcs hmcs
+				do
+				./lockbench --lock=$lock --threads=64 --duration=5 --placement=scatter --batch=64 >>results/lockbench_${lock}_numa64.csv
+				done
+			;;
+		handoff)
+			# FIFO locks against pthread_mutex_t: handoff_p50,handoff_p90,handoff_p99,handoff_max,handoffs after ops/sec
+			for lock in pthread ticket ticket-partitioned twa mcs
+				do
+				./lockbench --lock=$lock --threads=1,2,4,8,16,32,64,128,256 --duration=2 --cs-work=100 --handoff >>results/lockbench_${lock}_handoff.csv
+				done
+			;;
+		combining)
+			# short critical sections on shared data; a combiner (flat-combining) or the server thread (delegation, pinned to the last CPU) runs the closures
+			for lock in pthread mcs flat-combining delegation
+				do
+				./lockbench --lock=$lock --threads=1,2,4,8,16,32,64,128 --duration=2 --cs-work=0 --workload=counter >>results/lockbench_${lock}_counter.csv
+				./lockbench --lock=$lock --threads=1,2,4,8,16,32,64,128 --duration=2 --cs-work=0 --workload=queue >>results/lockbench_${lock}_queue.csv
+				done
+			;;
+		futex)
+			# bare futex mutex against pthread_mutex_t (run once more with the patched glibc on LD_LIBRARY_PATH), plain and under the shield
+			for lock in pthread futex pthread-shield-re futex-shield-re
+				do
+				./lockbench --lock=$lock --threads=1,64 --duration=5 --cs-work=100 --cpu >>results/lockbench_${lock}_futex.csv
+				done
+			for spin in 0 10 100 1000
+				do
+				./lockbench --lock=futex --threads=64 --duration=5 --cs-work=100 --cpu --futex-spin=$spin --futex-wake=one >>results/lockbench_futex_spin${spin}_wake1.csv
+				./lockbench --lock=futex --threads=64 --duration=5 --cs-work=100 --cpu --futex-spin=$spin --futex-wake=all >>results/lockbench_futex_spin${spin}_wakeall.csv
+				./lockbench --lock=futex --threads=64 --duration=5 --cs-work=100 --cpu --futex-spin=$spin --futex-pause=yield >>results/lockbench_futex_spin${spin}_yield.csv
+				done
+			;;
+		biased)
+			# thread 0 takes 99% of the locks; biased adds fast_acquires,slow_acquires,revocations,revoke_ns after ops/sec
+			for lock in pthread futex biased
+				do
+				./lockbench --lock=$lock --threads=2,8,64 --iters=100000000 --skew=99 --latency --sample=64 >>results/lockbench_${lock}_skew99.csv
+				done
+			for revoke in 1 8 64 1024
+				do
+				./lockbench --lock=biased --threads=8 --iters=100000000 --skew=99 --bias-after=16 --revoke-after=$revoke >>results/lockbench_biased_revoke${revoke}.csv
+				done
+			;;
+		rw)
+			for lock in pthread-rwlock std-shared-mutex bravo-pthread-rwlock bravo-std-shared rw-percpu rw-pernode
+				do
+				for reads in 100 99 90
+					do
+					./lockbench --lock=$lock --threads=1,2,4,8,16,32,64 --duration=2 --workload=counter --read-pct=$reads >>results/lockbench_${lock}_read${reads}.csv
+					done
+				done
+			;;
+		seqlock)
+			# seqlock readers against the RW locks (std-shared-mutex is mutex_bench -DRW) on a four-line record
+			for lock in seqlock-pthread seqlock-futex seqlock-mcs pthread-rwlock std-shared-mutex bravo-std-shared rw-percpu
+				do
+				for reads in 100 99 90
+					do
+					./lockbench --lock=$lock --threads=1,2,4,8,16,32,64 --duration=2 --workload=record --read-pct=$reads >>results/lockbench_${lock}_record${reads}.csv
+					done
+				done
+			;;
+		*)
+			echo "unknown sweep '$sweep' (openloop oversub numa handoff combining futex biased rw seqlock)" >&2
+			exit 1
+			;;
+		esac
+		done
+	done
+date
@@ -14,14 +14,12 @@
 #ifdef SHIELD_A
 #include "shielding_array.h"
 #endif
+#include "bench_stop.h"
+#include "placement.h"
+#include "perf_counters.h"
+#include "cpu_usage.h"
 using namespace std;
 
-// CPU ranges
-#define CPU_RANGE1_START 64
-#define CPU_RANGE1_END 127
-#define CPU_RANGE2_START 192
-#define CPU_RANGE2_END 255
-
 #define NUM_ITERATIONS 1000000000
 #define NUM_WARMUPITERATIONS 10000
 
@@ -34,21 +32,17 @@ std::mutex mylock;
 #endif
 
 
+double run_seconds = 0;     // > 0: --duration=<sec> run instead of NUM_ITERATIONS
+vector<long long> ops_completed;
+vector<struct perf_group> perf_groups;    // one per thread, used with --perf
+vector<struct cpu_usage> cpu_usages;      // one per thread, used with --cpu
+
 std::atomic<int> ready_count(0);
 std::atomic<bool> start_flag(false);
 
+// Pin the calling thread according to --placement (placement.h)
 void set_cpu_affinity(int thread_index) {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    
-    int cpu_id;
-    if (thread_index < 64) {
-        cpu_id =  CPU_RANGE1_START + thread_index;
-    } else {
-        cpu_id =  CPU_RANGE2_START + (thread_index - 64);
-    }
-    CPU_SET(cpu_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    placement_pin(thread_index);
 }
 
 // Simulated work function
@@ -63,6 +57,7 @@ void do_work(int amount) {
 void thread_function(int thread_id, int num_threads)  {
     // Warm-up phase
     set_cpu_affinity(thread_id);
+    perf_group_open(&perf_groups[thread_id]);
     for (long int i = 0; i < NUM_WARMUPITERATIONS; i++) {
 #ifdef NESTED
         myNestLock.lock();
@@ -92,10 +87,12 @@ void thread_function(int thread_id, int num_threads)  {
     ready_count.fetch_add(1);
     while (!start_flag.load(std::memory_order_acquire))
         std::this_thread::yield();
-
+    perf_group_start(&perf_groups[thread_id]);
+    cpu_usage_start(&cpu_usages[thread_id]);
 
     // Lock testing loop
-    for (long int i = 0; i < iterations_per_thread; i++) {
+    long long i;
+    for (i = 0; run_seconds > 0 ? !bench_should_stop() : i < iterations_per_thread; i++) {
 #ifdef NESTED
         myNestLock.lock();
 //        do_work(100);
@@ -113,6 +110,9 @@ void thread_function(int thread_id, int num_threads)  {
         mylock.unlock();
 #endif
     }
+    perf_group_stop(&perf_groups[thread_id]);
+    cpu_usage_stop(&cpu_usages[thread_id]);
+    ops_completed[thread_id] = i;
 
     // End timing
     // auto end = std::chrono::high_resolution_clock::now();
@@ -124,15 +124,23 @@ void thread_function(int thread_id, int num_threads)  {
 }
 
 int main(int argc, char *argv[]) {
+    run_seconds = bench_parse_duration(&argc, argv);
+    placement_parse(&argc, argv);
+    perf_parse(&argc, argv);
+    cpu_usage_parse(&argc, argv);
     if (argc != 2) {
-        cout << "Usage: ./<exe> <num_threads>" << endl;
+        cout << "Usage: ./<exe> <num_threads> [--duration=<sec>] [--placement=<policy>] [--perf] [--cpu]" << endl;
         return 1;
     }
 
     int numWorkers = atoi(argv[1]);
+    placement_log(stderr, numWorkers);
     vector<thread> threads;
     struct timeval timeStart, timeEnd;
     long long elapsed = 0;
+    ops_completed.assign(numWorkers, 0);
+    perf_groups.resize(numWorkers);
+    cpu_usages.resize(numWorkers);
 
     // Launch threads
     for (int i = 0; i < numWorkers; i++) {
@@ -146,6 +154,8 @@ int main(int argc, char *argv[]) {
     // Start benchmark
     gettimeofday(&timeStart, nullptr);
     start_flag.store(true, std::memory_order_release);
+    if (run_seconds > 0)
+        bench_stop_start(run_seconds);
 
     // Join all threads
     for (auto &t : threads)
@@ -153,10 +163,17 @@ int main(int argc, char *argv[]) {
 
     // End benchmark
     gettimeofday(&timeEnd, nullptr);
+    bench_stop_join();
+    long long total_ops = 0;
+    for (long long ops : ops_completed)
+        total_ops += ops;
     elapsed = (timeEnd.tv_sec - timeStart.tv_sec) * 1000000LL +
               (timeEnd.tv_usec - timeStart.tv_usec);
 
-    printf("%d,%f,%f\n", numWorkers, elapsed / 1e6, NUM_ITERATIONS / (elapsed / 1e6));
+    printf("%d,%f,%f", numWorkers, elapsed / 1e6, total_ops / (elapsed / 1e6));
+    perf_print_columns(stdout, perf_groups.data(), numWorkers, total_ops);
+    cpu_usage_print_columns(stdout, cpu_usages.data(), numWorkers, total_ops);
+    printf("\n");
     return 0;
 }
 
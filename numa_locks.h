@@ -0,0 +1,218 @@
+#ifndef NUMA_LOCKS_H
+#define NUMA_LOCKS_H
+
+// NUMA-aware cohort locks: C-BO-MCS (Dice, Marathe & Shavit lock cohorting)
+// and a two-level HMCS (Chabbi, Fagan & Mellor-Crummey).
+//
+// Every NUMA node has its own local MCS queue; whoever heads it takes the
+// global lock on behalf of the node.  On release the holder hands the
+// global lock straight to the next waiter of its own node, without
+// touching the global lock at all, until numa_lock_batch consecutive
+// local hand-overs have been made or the local queue is empty; only then
+// is the global lock released and the other nodes get their turn.  The
+// two locks differ in the global lock: a test-and-test-and-set lock with
+// exponential backoff for C-BO-MCS, an MCS lock (queue_locks.h) for HMCS.
+//
+// Node membership is the /sys/devices/system/node table placement.h
+// reads; each thread looks its node up once, at its first acquisition,
+// from the CPU it runs on (so pin before locking).  numa_cohort_init()
+// runs placement_init("none") if nobody has filled the table yet.
+//
+// Every acquisition is also counted, per thread, as a hand-over that
+// stayed on the previous holder's node (intra) or crossed to another node
+// (inter); lockbench and the -DQLOCK_CBOMCS/-DQLOCK_HMCS harnesses
+// (qlock_select.h) sum and print them.
+//
+// Spin-only and not reentrant.  Plain C, needs _GNU_SOURCE.
+
+#include <sched.h>
+#include <stdint.h>
+#include "placement.h"
+#include "queue_locks.h"
+
+#ifndef NUMA_LOCK_BATCH
+#define NUMA_LOCK_BATCH 64          // default bound on local hand-overs
+#endif
+#define NUMA_BO_MAX_DELAY 1024      // pause iterations, C-BO-MCS backoff cap
+
+// hand-over word of the local queues
+#define NUMA_WAIT 0
+#define NUMA_TAKE_GLOBAL 1          // local lock only; acquire the global lock
+#define NUMA_GLOBAL_PASSED 2        // global lock comes with it
+
+static int numa_lock_batch = NUMA_LOCK_BATCH;
+
+static __thread int numa_self_node = -1;
+static __thread uint64_t numa_intra_handoffs;
+static __thread uint64_t numa_inter_handoffs;
+
+static inline int numa_lock_node(void) {
+    if (numa_self_node < 0) {
+        int cpu = sched_getcpu();
+        numa_self_node = cpu < 0 ? 0 : placement_node_of_cpu(cpu);
+    }
+    return numa_self_node;
+}
+
+struct numa_local {
+    struct ql_node* tail;
+    struct ql_node* holder;
+    int batch;                      // local hand-overs since the global acquire
+} __attribute__((aligned(64)));
+
+struct numa_cohort {
+    struct numa_local local[PLACEMENT_MAX_NODES];
+    int last_node;                  // node of the previous holder, -1 at first
+};
+
+static inline void numa_cohort_init(struct numa_cohort* c) {
+    if (placement.ncpus == 0)
+        placement_init("none");
+    for (int n = 0; n < PLACEMENT_MAX_NODES; n++) {
+        c->local[n].tail = NULL;
+        c->local[n].holder = NULL;
+        c->local[n].batch = 0;
+    }
+    c->last_node = -1;
+}
+
+// Queue on node n's local lock; returns 1 if the global lock was passed
+// along with it
+static inline int numa_local_acquire(struct numa_cohort* c, int n) {
+    struct numa_local* loc = &c->local[n];
+    struct ql_node* me = ql_node_get();
+    int state = NUMA_TAKE_GLOBAL;
+    me->next = NULL;
+    me->granted = NUMA_WAIT;
+    struct ql_node* pred = __atomic_exchange_n(&loc->tail, me, __ATOMIC_ACQ_REL);
+    if (pred) {
+        __atomic_store_n(&pred->next, me, __ATOMIC_RELEASE);
+        while ((state = __atomic_load_n(&me->granted, __ATOMIC_ACQUIRE)) == NUMA_WAIT)
+            ql_pause();
+    }
+    loc->holder = me;
+    if (state == NUMA_GLOBAL_PASSED) {
+        loc->batch++;
+        return 1;
+    }
+    loc->batch = 0;
+    return 0;
+}
+
+// Holder bookkeeping, once both levels are held
+static inline void numa_cohort_acquired(struct numa_cohort* c, int n) {
+    if (c->last_node == n)
+        numa_intra_handoffs++;
+    else if (c->last_node >= 0)
+        numa_inter_handoffs++;
+    c->last_node = n;
+}
+
+// Hand the local lock of node n to its successor with `state`; with
+// `only_if_waiting` give up (return 0) instead of releasing when nobody
+// is queued
+static inline int numa_local_release(struct numa_cohort* c, int n, int state, int only_if_waiting) {
+    struct numa_local* loc = &c->local[n];
+    struct ql_node* me = loc->holder;
+    struct ql_node* next = __atomic_load_n(&me->next, __ATOMIC_ACQUIRE);
+    if (!next) {
+        if (only_if_waiting) {
+            if (__atomic_load_n(&loc->tail, __ATOMIC_ACQUIRE) == me)
+                return 0;
+        } else {
+            struct ql_node* expected = me;
+            if (__atomic_compare_exchange_n(&loc->tail, &expected, NULL, 0,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+                ql_node_put(me);
+                return 1;
+            }
+        }
+        int spins = 0;
+        while (!(next = __atomic_load_n(&me->next, __ATOMIC_ACQUIRE)))
+            ql_backoff(&spins);
+    }
+    __atomic_store_n(&next->granted, state, __ATOMIC_RELEASE);
+    ql_node_put(me);
+    return 1;
+}
+
+// Keep the global lock on node n if the batch allows and a local waiter
+// is queued
+static inline int numa_cohort_pass(struct numa_cohort* c, int n) {
+    return c->local[n].batch < numa_lock_batch &&
+           numa_local_release(c, n, NUMA_GLOBAL_PASSED, 1);
+}
+
+// C-BO-MCS: global test-and-test-and-set lock with exponential backoff
+
+typedef struct {
+    int global;
+    struct numa_cohort c __attribute__((aligned(64)));
+} cbomcs_lock_t;
+
+static inline void cbomcs_init(cbomcs_lock_t* l) {
+    l->global = 0;
+    numa_cohort_init(&l->c);
+}
+
+static inline void cbomcs_destroy(cbomcs_lock_t* l) {
+    (void)l;
+}
+
+static inline void cbomcs_lock(cbomcs_lock_t* l) {
+    int n = numa_lock_node();
+    if (!numa_local_acquire(&l->c, n)) {
+        int delay = 1;
+        while (__atomic_load_n(&l->global, __ATOMIC_RELAXED) ||
+               __atomic_exchange_n(&l->global, 1, __ATOMIC_ACQUIRE)) {
+            for (int i = 0; i < delay; i++)
+                ql_pause();
+            if (delay < NUMA_BO_MAX_DELAY)
+                delay <<= 1;
+        }
+    }
+    numa_cohort_acquired(&l->c, n);
+}
+
+static inline void cbomcs_unlock(cbomcs_lock_t* l) {
+    int n = numa_lock_node();
+    if (numa_cohort_pass(&l->c, n))
+        return;
+    __atomic_store_n(&l->global, 0, __ATOMIC_RELEASE);
+    numa_local_release(&l->c, n, NUMA_TAKE_GLOBAL, 0);
+}
+
+// HMCS: MCS at both levels; the global MCS lock may be released by a
+// different thread of the node than the one that took it, which
+// mcs_lock_t allows since it keeps the owner's node in the lock
+
+typedef struct {
+    mcs_lock_t global;
+    struct numa_cohort c __attribute__((aligned(64)));
+} hmcs_lock_t;
+
+static inline void hmcs_init(hmcs_lock_t* l) {
+    mcs_init(&l->global, 0);
+    numa_cohort_init(&l->c);
+}
+
+static inline void hmcs_destroy(hmcs_lock_t* l) {
+    mcs_destroy(&l->global);
+}
+
+static inline void hmcs_lock(hmcs_lock_t* l) {
+    int n = numa_lock_node();
+    if (!numa_local_acquire(&l->c, n))
+        mcs_lock(&l->global);
+    numa_cohort_acquired(&l->c, n);
+}
+
+static inline void hmcs_unlock(hmcs_lock_t* l) {
+    int n = numa_lock_node();
+    if (numa_cohort_pass(&l->c, n))
+        return;
+    mcs_unlock(&l->global);
+    numa_local_release(&l->c, n, NUMA_TAKE_GLOBAL, 0);
+}
+
+#endif // NUMA_LOCKS_H
@@ -4,6 +4,10 @@
 #include<omp.h>
 #include<sys/time.h>
 #include <unistd.h>
+#include "bench_stop.h"
+#include "placement.h"
+#include "perf_counters.h"
+#include "cpu_usage.h"
 using namespace std;
 
 #define NUM_ITERATIONS 100000000
@@ -22,7 +26,24 @@ void do_work(int amount) {
     }
 }
 
+// One critical section of the timed phase
+static inline void lock_op() {
+#ifdef NESTED
+        omp_set_nest_lock(&myNestLock);
+        do_work(100);
+        omp_unset_nest_lock(&myNestLock);
+#else
+	omp_set_lock(&mylock);
+	do_work(100);
+	omp_unset_lock(&mylock);
+#endif
+}
+
 int main(int argc, char* argv[]){
+	double run_seconds = bench_parse_duration(&argc, argv);
+	placement_parse(&argc, argv);
+	perf_parse(&argc, argv);
+	cpu_usage_parse(&argc, argv);
 
     // Set CPU binding environment variables with corrected format
     // setenv("OMP_PROC_BIND", "spread", 1);  // Using 'spread' to distribute threads evenly
@@ -30,7 +51,8 @@ int main(int argc, char* argv[]){
     // Define explicit list of processors
     // setenv("OMP_WAIT_POLICY", "active", 1);
     // setenv("GOMP_CPU_AFFINITY", "64-127 192-255", 1);
-    setenv("GOMP_CPU_AFFINITY", "64-127", 1);
+    // setenv("GOMP_CPU_AFFINITY", "64-127", 1);
+    // threads are pinned by --placement inside the parallel region instead
 #ifdef NESTED
 	omp_init_nest_lock(&myNestLock);
 #else
@@ -39,15 +61,20 @@ int main(int argc, char* argv[]){
 
 	int warmupIterations=10000;
 	if(argc != 2) {
-		printf("usage:./<exe> <num_threads>\n");
+		printf("usage:./<exe> <num_threads> [--duration=<sec>] [--placement=<policy>] [--perf] [--cpu]\n");
 		exit(0);
 	}
 	
 	// int threadID; 
 	long int i=0;
 	long long elapsed=0;
+	// --duration: every thread runs until the stop flag, not a share of NUM_ITERATIONS
+	long long total_ops = run_seconds > 0 ? 0 : NUM_ITERATIONS;
 	//initializing number of workers.
 	int numWorkers=atoi(argv[1]);
+	placement_log(stderr, numWorkers);
+	struct perf_group perf[numWorkers];    // one per thread, used with --perf
+	struct cpu_usage cpu_use[numWorkers];  // one per thread, used with --cpu
 
 	struct timeval timeStart, timeEnd;
 
@@ -55,9 +82,11 @@ int main(int argc, char* argv[]){
 	omp_set_num_threads(numWorkers);
 
 	//initializing matrices in parallel.
-#pragma omp parallel shared(timeStart, timeEnd) //private(threadID)
+#pragma omp parallel shared(timeStart, timeEnd, total_ops) //private(threadID)
 	{
         int threadID = omp_get_thread_num();
+        placement_pin(threadID);
+        perf_group_open(&perf[threadID]);
 
         // Print thread binding information
         /*#pragma omp critical
@@ -79,20 +108,29 @@ int main(int argc, char* argv[]){
 
 
 #pragma omp barrier
-	if(threadID == 0)
+	if(threadID == 0) {
 		gettimeofday(&timeStart, 0);
+		if (run_seconds > 0)
+			bench_stop_start(run_seconds);
+	}
+	perf_group_start(&perf[threadID]);
+	cpu_usage_start(&cpu_use[threadID]);
+	if (run_seconds > 0) {
+		long long ops = 0;
+		while (!bench_should_stop()) {
+			lock_op();
+			ops++;
+		}
+		#pragma omp atomic
+		total_ops += ops;
+	} else {
 	#pragma omp for
 	for (i=0; i<NUM_ITERATIONS; i++){
-#ifdef NESTED
-        omp_set_nest_lock(&myNestLock);
-        do_work(100);
-        omp_unset_nest_lock(&myNestLock);
-#else
-	omp_set_lock(&mylock);
-	do_work(100);
-	omp_unset_lock(&mylock);
-#endif
+		lock_op();
+	}
 	}
+	perf_group_stop(&perf[threadID]);
+	cpu_usage_stop(&cpu_use[threadID]);
 #pragma omp barrier
 	if(threadID == 0){
 		gettimeofday(&timeEnd, 0);
@@ -100,13 +138,17 @@ int main(int argc, char* argv[]){
 	   }
 	}
 
+	bench_stop_join();
 #ifdef NESTED
     omp_destroy_nest_lock(&myNestLock);
 #else
 	omp_destroy_lock(&mylock);
 #endif
 
-	printf ("%d,%f,%f\n",numWorkers, elapsed/(double)1000000, NUM_ITERATIONS/(elapsed/(double)1000000));
+	printf ("%d,%f,%f",numWorkers, elapsed/(double)1000000, total_ops/(elapsed/(double)1000000));
+	perf_print_columns(stdout, perf, numWorkers, total_ops);
+	cpu_usage_print_columns(stdout, cpu_use, numWorkers, total_ops);
+	printf ("\n");
 	return 0;
 }
 
@@ -3,6 +3,10 @@
 #include<cstdlib>
 #include<omp.h>
 #include<sys/time.h>
+#include "bench_stop.h"
+#include "perf_counters.h"
+#include "cpu_usage.h"
+#include "qlock_select.h"     // last: -DQLOCK_* swaps pthread_mutex_t for a queue lock
 using namespace std;
 
 #define NUM_ITERATIONS 100000000
@@ -10,20 +14,28 @@ using namespace std;
 //omp_lock_t mylock;
 pthread_mutex_t mylock;
 int main(int argc, char* argv[]){
+	double run_seconds = bench_parse_duration(&argc, argv);
+	perf_parse(&argc, argv);
+	cpu_usage_parse(&argc, argv);
+	qlock_parse(&argc, argv);
 	//omp_init_lock(&mylock);
 	pthread_mutex_init(&mylock,NULL);
 
 	int warmupIterations=10000;
 	if(argc != 2) {
-		printf("usage:./<exe> <num_threads>\n");
+		printf("usage:./<exe> <num_threads> [--duration=<sec>] [--perf] [--cpu]\n");
 		exit(0);
 	}
 	
 	int threadID; 
 	long int i=0;
 	long long elapsed=0;
+	// --duration: every thread runs until the stop flag, not a share of NUM_ITERATIONS
+	long long total_ops = run_seconds > 0 ? 0 : NUM_ITERATIONS;
 	//initializing number of workers.
 	int numWorkers=atoi(argv[1]);
+	struct perf_group perf[numWorkers];    // one per thread, used with --perf
+	struct cpu_usage cpu_use[numWorkers];  // one per thread, used with --cpu
 
 	struct timeval timeStart, timeEnd;
 	//timeStart=(struct timeval*)malloc(sizeof(struct timeval)*numWorkers);
@@ -35,7 +47,7 @@ int main(int argc, char* argv[]){
 
 	//printf("Num of thread:%d\n",numWorkers);
 	//initializing matrices in parallel.
-#pragma omp parallel shared(timeStart, timeEnd) private(threadID)
+#pragma omp parallel shared(timeStart, timeEnd, total_ops) private(threadID)
 	{
 	#pragma omp for 
 	for (i=0; i<NUM_WARMUPITERATIONS; i++){
@@ -46,10 +58,26 @@ int main(int argc, char* argv[]){
 	}
 
 	threadID=omp_get_thread_num();
+	perf_group_open(&perf[threadID]);
 	//printf("Num of thread:%d\n",numWorkers);
 #pragma omp barrier
-	if(threadID == 0)
+	if(threadID == 0) {
 		gettimeofday(&timeStart, 0);
+		if (run_seconds > 0)
+			bench_stop_start(run_seconds);
+	}
+	perf_group_start(&perf[threadID]);
+	cpu_usage_start(&cpu_use[threadID]);
+	if (run_seconds > 0) {
+		long long ops = 0;
+		while (!bench_should_stop()) {
+			pthread_mutex_lock(&mylock);
+			pthread_mutex_unlock(&mylock);
+			ops++;
+		}
+		#pragma omp atomic
+		total_ops += ops;
+	} else {
 	#pragma omp for
 	for (i=0; i<NUM_ITERATIONS; i++){
 		//omp_set_lock(&mylock);
@@ -57,6 +85,9 @@ int main(int argc, char* argv[]){
 		pthread_mutex_lock(&mylock);
 		pthread_mutex_unlock(&mylock);
 	}
+	}
+	perf_group_stop(&perf[threadID]);
+	cpu_usage_stop(&cpu_use[threadID]);
 #pragma omp barrier
 	if(threadID == 0){
 		gettimeofday(&timeEnd, 0);
@@ -65,10 +96,14 @@ int main(int argc, char* argv[]){
 	   }
 	}
 
+	bench_stop_join();
 	//omp_destroy_lock(&mylock);
 	pthread_mutex_destroy(&mylock);
 	//printf ("\nDone.	%f	sec\n",elapsed/(double)1000000);
-	printf ("%d,%f,%f\n",numWorkers, elapsed/(double)1000000, NUM_ITERATIONS/(elapsed/(double)1000000));
+	printf ("%d,%f,%f",numWorkers, elapsed/(double)1000000, total_ops/(elapsed/(double)1000000));
+	perf_print_columns(stdout, perf, numWorkers, total_ops);
+	cpu_usage_print_columns(stdout, cpu_use, numWorkers, total_ops);
+	printf ("\n");
 	return 0;
 }
 
@@ -0,0 +1,95 @@
+#ifndef OPEN_LOOP_H
+#define OPEN_LOOP_H
+
+// Open-loop arrivals for the lock benchmarks (lockbench --rate).
+//
+// In the closed loop every thread retries as soon as its last operation
+// finishes, so a slow lock simply lowers the request rate and its queueing
+// delay never shows up.  Here every thread follows its own arrival
+// schedule instead: requests are due every 1/rate seconds (constant) or
+// after exponentially distributed gaps (poisson), and a thread that falls
+// behind works off the backlog without skipping any.  Latency is taken
+// from the scheduled arrival, not from when the thread got round to the
+// request, which is what keeps coordinated omission out of the numbers.
+//
+// Times are lat_now() ticks (lat_hist.h).
+//
+// Plain C so the .c harnesses can include it as well.
+
+#include <math.h>
+#include <stdint.h>
+#include <time.h>
+#include "lat_hist.h"
+
+enum arrival_kind { ARRIVAL_CONSTANT, ARRIVAL_POISSON };
+
+struct arrival {
+    uint64_t next;          // scheduled time of the next request
+    double mean;            // mean gap in ticks
+    double tsc_per_ns;
+    enum arrival_kind kind;
+    uint64_t rng;           // xorshift64 state for poisson gaps
+};
+
+static inline double arrival_uniform(struct arrival* a) {
+    a->rng ^= a->rng << 13;
+    a->rng ^= a->rng >> 7;
+    a->rng ^= a->rng << 17;
+    return ((a->rng >> 11) + 0.5) / 9007199254740992.0;    // (0,1)
+}
+
+static inline uint64_t arrival_gap(struct arrival* a) {
+    if (a->kind == ARRIVAL_POISSON)
+        return (uint64_t)(-log(arrival_uniform(a)) * a->mean);
+    return (uint64_t)a->mean;
+}
+
+// Schedule for one of `threads` threads offering `rate` requests per second
+// from `start`; constant schedules are staggered so the threads do not
+// all arrive at once.
+static inline void arrival_init(struct arrival* a, uint64_t start, double rate, double tsc_per_ns,
+                                enum arrival_kind kind, int thread, int threads) {
+    a->mean = 1e9 / rate * tsc_per_ns;
+    a->tsc_per_ns = tsc_per_ns;
+    a->kind = kind;
+    a->rng = 0x9E3779B97F4A7C15ULL * (uint64_t)(thread + 1);
+    if (kind == ARRIVAL_CONSTANT)
+        a->next = start + (uint64_t)(a->mean * thread / threads);
+    else
+        a->next = start + arrival_gap(a);
+}
+
+// Wait for the next request to become due and return its scheduled time.
+// Sleeps while it is far off, spins for the last stretch; returns at once
+// when the thread is already behind.
+static inline uint64_t arrival_wait(struct arrival* a) {
+    uint64_t due = a->next;
+    uint64_t now = lat_now();
+    if (now < due) {
+        double ns = (due - now) / a->tsc_per_ns;
+        if (ns > 200000) {
+            struct timespec ts;
+            ns -= 100000;
+            ts.tv_sec = (time_t)(ns / 1e9);
+            ts.tv_nsec = (long)(ns - ts.tv_sec * 1e9);
+            nanosleep(&ts, NULL);
+        }
+        while (lat_now() < due)
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#else
+            ;
+#endif
+    }
+    a->next += arrival_gap(a);
+    return due;
+}
+
+// Requests already due at `now` but not yet served
+static inline uint64_t arrival_backlog(const struct arrival* a, uint64_t now) {
+    if (now < a->next)
+        return 0;
+    return (uint64_t)((now - a->next) / a->mean) + 1;
+}
+
+#endif // OPEN_LOOP_H
@@ -0,0 +1,155 @@
+#ifndef PARKING_LOT_H
+#define PARKING_LOT_H
+
+// One-byte locks over a global parking lot, after WebKit's WTF::Lock
+// (Pizlo, "Locking in WebKit"): the lock itself holds only two bits,
+//
+//   PL_LOCKED   somebody holds it
+//   PL_PARKED   somebody may be asleep waiting for it
+//
+// and everything a sleeping thread needs lives in one process-wide hash
+// table of PL_BUCKETS buckets keyed by lock address.  Each bucket has its
+// own little spinlock and a FIFO of parked threads; a thread parks at most
+// once at a time, so its queue entry is a per-thread element.  Millions of
+// locks cost a byte each plus the fixed table, instead of 40 bytes each
+// for pthread_mutex_t.
+//
+// lock() CASes the LOCKED bit in, spins PL_SPIN times yielding the CPU in
+// between, and then parks: under the bucket lock it sets PARKED (giving
+// up if the lock came free meanwhile), queues itself and sleeps on its own
+// futex word.  unlock() clears a plain LOCKED with one CAS; with PARKED set
+// it takes the bucket lock, dequeues the first thread parked on this
+// lock, leaves PARKED set only if more are queued and wakes the dequeued
+// one, which then competes for the lock again (barging, no hand-off).
+// The table does not grow: colliding locks share a bucket and its queue.
+//
+// Not reentrant.  Plain C so the .c harnesses can include it as well.
+
+#include <stdint.h>
+#include <sched.h>
+#include "queue_locks.h"        // ql_backoff(), ql_sleep(), ql_grant()
+
+#define PL_BUCKETS 4096         // power of two
+#define PL_SPIN 40              // yields before parking, as in WebKit
+
+#define PL_LOCKED 1
+#define PL_PARKED 2
+
+typedef uint8_t pl_lock_t;
+
+struct pl_waiter {
+    const pl_lock_t* lock;
+    struct pl_waiter* next;
+    int granted;                // ql hand-over word: 0 wait, 1 woken, 2 asleep
+};
+
+struct pl_bucket {
+    int lock;
+    struct pl_waiter* head;
+    struct pl_waiter* tail;
+} __attribute__((aligned(64)));
+
+static struct pl_bucket pl_buckets[PL_BUCKETS];
+
+static __thread struct pl_waiter pl_self;
+
+static inline struct pl_bucket* pl_bucket_of(const pl_lock_t* l) {
+    return &pl_buckets[((uintptr_t)l * 0x9E3779B97F4A7C15ull) >> 52 & (PL_BUCKETS - 1)];
+}
+
+static inline void pl_bucket_lock(struct pl_bucket* b) {
+    int spins = 0;
+    while (__atomic_load_n(&b->lock, __ATOMIC_RELAXED) ||
+           __atomic_exchange_n(&b->lock, 1, __ATOMIC_ACQUIRE))
+        ql_backoff(&spins);
+}
+
+static inline void pl_bucket_unlock(struct pl_bucket* b) {
+    __atomic_store_n(&b->lock, 0, __ATOMIC_RELEASE);
+}
+
+static inline void pl_init(pl_lock_t* l) {
+    *l = 0;
+}
+
+static inline void pl_destroy(pl_lock_t* l) {
+    (void)l;
+}
+
+// Set LOCKED if it is clear; 1 on success
+static inline int pl_try_lock(pl_lock_t* l) {
+    uint8_t c = __atomic_load_n(l, __ATOMIC_RELAXED);
+    while (!(c & PL_LOCKED))
+        if (__atomic_compare_exchange_n(l, &c, c | PL_LOCKED, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return 1;
+    return 0;
+}
+
+// Queue on l's bucket and sleep, unless l is free (or its state changes)
+// by the time the bucket is locked
+static inline void pl_park(pl_lock_t* l) {
+    struct pl_bucket* b = pl_bucket_of(l);
+    struct pl_waiter* me = &pl_self;
+    pl_bucket_lock(b);
+    uint8_t c = __atomic_load_n(l, __ATOMIC_RELAXED);
+    if (!(c & PL_LOCKED) ||
+        (!(c & PL_PARKED) &&
+         !__atomic_compare_exchange_n(l, &c, c | PL_PARKED, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))) {
+        pl_bucket_unlock(b);
+        return;
+    }
+    me->lock = l;
+    me->next = NULL;
+    me->granted = 0;
+    if (b->tail)
+        b->tail->next = me;
+    else
+        b->head = me;
+    b->tail = me;
+    pl_bucket_unlock(b);
+    ql_sleep(&me->granted);
+}
+
+static inline void pl_lock(pl_lock_t* l) {
+    uint8_t c = 0;
+    if (__atomic_compare_exchange_n(l, &c, PL_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return;
+    for (int spins = 0; ; spins++) {
+        if (pl_try_lock(l))
+            return;
+        if (spins < PL_SPIN && !(__atomic_load_n(l, __ATOMIC_RELAXED) & PL_PARKED))
+            sched_yield();
+        else
+            pl_park(l);
+    }
+}
+
+static inline void pl_unlock(pl_lock_t* l) {
+    uint8_t c = PL_LOCKED;
+    if (__atomic_compare_exchange_n(l, &c, 0, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        return;
+    // PARKED is set, and can only change under the bucket lock
+    struct pl_bucket* b = pl_bucket_of(l);
+    pl_bucket_lock(b);
+    struct pl_waiter *w = b->head, *prev = NULL, *more;
+    while (w && w->lock != l) {
+        prev = w;
+        w = w->next;
+    }
+    if (w) {
+        if (prev)
+            prev->next = w->next;
+        else
+            b->head = w->next;
+        if (b->tail == w)
+            b->tail = prev;
+    }
+    for (more = w ? w->next : NULL; more && more->lock != l; more = more->next)
+        ;
+    __atomic_store_n(l, more ? PL_PARKED : 0, __ATOMIC_RELEASE);
+    pl_bucket_unlock(b);
+    if (w)
+        ql_grant(&w->granted, 1);
+}
+
+#endif // PARKING_LOT_H
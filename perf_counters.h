@@ -0,0 +1,152 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+// Per-thread perf_event_open counters for the lock benchmarks (--perf).
+//
+// Every worker opens one counter group for itself before the warm-up,
+// enables it right after the start barrier and disables and reads it
+// before the stop barrier, so only the timed phase is counted.  Events
+// the kernel or the PMU does not offer (no hardware counters in a VM,
+// perf_event_paranoid) are left out of the group and reported as n/a.
+// The harnesses then print the sum over all threads divided by the number
+// of operations as extra CSV columns:
+//   cache_misses,llc_misses,ctx_switches,cpu_migrations,page_faults
+// (all per lock operation).
+//
+// Everything is a no-op unless perf_parse() saw --perf, so the harnesses
+// call these unconditionally.
+//
+// Plain C so the .c harnesses can include it as well.
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define PERF_NUM_COUNTERS 5
+
+static const struct {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+} perf_events[PERF_NUM_COUNTERS] = {
+    { "cache_misses",   PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "llc_misses",     PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+                                            (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { "ctx_switches",   PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+    { "cpu_migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS },
+    { "page_faults",    PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+};
+
+struct perf_group {
+    int leader;                         // -1: nothing could be opened
+    int fd[PERF_NUM_COUNTERS];          // -1: event not supported; kept after close
+    int slot[PERF_NUM_COUNTERS];        // position in the group read
+    double value[PERF_NUM_COUNTERS];    // scaled if the group was multiplexed
+};
+
+static int perf_counters_enabled;
+
+static int perf_event_open_self(struct perf_event_attr* attr, int group_fd) {
+    int fd = syscall(SYS_perf_event_open, attr, 0, -1, group_fd, 0);
+    if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+        // paranoid setting: user-space only is still better than nothing
+        attr->exclude_kernel = 1;
+        fd = syscall(SYS_perf_event_open, attr, 0, -1, group_fd, 0);
+    }
+    return fd;
+}
+
+// Open the group for the calling thread, disabled
+static void perf_group_open(struct perf_group* g) {
+    int n = 0;
+    g->leader = -1;
+    for (int k = 0; k < PERF_NUM_COUNTERS; k++) {
+        g->fd[k] = -1;
+        g->value[k] = 0;
+        if (!perf_counters_enabled)
+            continue;
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perf_events[k].type;
+        attr.config = perf_events[k].config;
+        attr.disabled = g->leader < 0;  // members follow the leader
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+        g->fd[k] = perf_event_open_self(&attr, g->leader);
+        if (g->fd[k] < 0)
+            continue;
+        if (g->leader < 0)
+            g->leader = g->fd[k];
+        g->slot[k] = n++;
+    }
+}
+
+static inline void perf_group_start(struct perf_group* g) {
+    if (g->leader < 0)
+        return;
+    ioctl(g->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(g->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// Disable and read the group, then close it
+static inline void perf_group_stop(struct perf_group* g) {
+    uint64_t buf[3 + PERF_NUM_COUNTERS];    // nr, time_enabled, time_running, values
+    if (g->leader < 0)
+        return;
+    ioctl(g->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (read(g->leader, buf, sizeof(buf)) >= (ssize_t)(3 * sizeof(uint64_t))) {
+        double scale = buf[2] > 0 && buf[2] < buf[1] ? (double)buf[1] / buf[2] : 1.0;
+        for (int k = 0; k < PERF_NUM_COUNTERS; k++)
+            if (g->fd[k] >= 0 && (uint64_t)g->slot[k] < buf[0])
+                g->value[k] = buf[3 + g->slot[k]] * scale;
+    }
+    for (int k = 0; k < PERF_NUM_COUNTERS; k++)
+        if (g->fd[k] >= 0 && g->fd[k] != g->leader)
+            close(g->fd[k]);
+    close(g->leader);
+    g->leader = -1;
+}
+
+// Append the per-operation columns for `threads` groups; an event no
+// thread could open prints n/a
+static void perf_print_columns(FILE* out, const struct perf_group* g, int threads, double ops) {
+    if (!perf_counters_enabled)
+        return;
+    for (int k = 0; k < PERF_NUM_COUNTERS; k++) {
+        double sum = 0;
+        int supported = 0;
+        for (int t = 0; t < threads; t++) {
+            if (g[t].fd[k] >= 0) {
+                supported = 1;
+                sum += g[t].value[k];
+            }
+        }
+        if (supported)
+            fprintf(out, ",%.6f", ops > 0 ? sum / ops : 0.0);
+        else
+            fprintf(out, ",n/a");
+    }
+}
+
+// Pull --perf out of argv (any position)
+static inline void perf_parse(int* argc, char** argv) {
+    int out = 1;
+    for (int i = 1; i < *argc; i++) {
+        if (strcmp(argv[i], "--perf") == 0)
+            perf_counters_enabled = 1;
+        else
+            argv[out++] = argv[i];
+    }
+    argv[out] = NULL;
+    *argc = out;
+}
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,270 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+// Topology-aware thread placement for the lock benchmarks, replacing the
+// hard-coded CPU_RANGE*_START tables.  placement_init() reads the CPUs this
+// process may run on (sched_getaffinity) and their core / package / NUMA
+// node from /sys/devices/system, then orders them by policy:
+//
+//   compact        fill one NUMA node before the next, one CPU per physical
+//                  core first, SMT siblings only once every core is used
+//   scatter        round-robin over NUMA nodes, each node in compact order
+//   smt-pairs      threads 2k and 2k+1 on the two SMT siblings of one core
+//   one-per-core   only the first SMT sibling of every core
+//   per-numa-node  fill nodes like compact, but bind each thread to its
+//                  node's whole CPU set instead of a single CPU
+//   none           no pinning at all
+//
+// Thread i gets slot i of that order, wrapping around when there are more
+// threads than slots.  The harnesses take --placement=<policy> (default
+// compact) and log the resulting mapping on stderr, including how many
+// threads share a slot once they wrap around.
+//
+// Plain C so the .c harnesses can include it as well; needs _GNU_SOURCE.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PLACEMENT_MAX_NODES 64
+
+enum placement_policy {
+    PLACE_COMPACT,
+    PLACE_SCATTER,
+    PLACE_SMT_PAIRS,
+    PLACE_ONE_PER_CORE,
+    PLACE_PER_NUMA_NODE,
+    PLACE_NONE,
+};
+
+static const char* const placement_names[] = {
+    "compact", "scatter", "smt-pairs", "one-per-core", "per-numa-node", "none",
+};
+
+struct placement_cpu {
+    int cpu;
+    int core;       // core_id
+    int package;    // physical_package_id
+    int node;       // NUMA node, 0 without /sys/devices/system/node
+    int smt;        // 0 for the lowest-numbered allowed sibling, then 1, ...
+};
+
+static struct {
+    enum placement_policy policy;
+    int ncpus;                          // allowed CPUs
+    struct placement_cpu cpus[CPU_SETSIZE];
+    int nslots;
+    int slot[CPU_SETSIZE];              // index into cpus[], in policy order
+    cpu_set_t node_mask[PLACEMENT_MAX_NODES];
+} placement;
+
+static const char* placement_policy_name = "compact";
+
+static inline int placement_read_int(const char* path, int fallback) {
+    FILE* f = fopen(path, "r");
+    int v;
+    if (!f)
+        return fallback;
+    if (fscanf(f, "%d", &v) != 1)
+        v = fallback;
+    fclose(f);
+    return v;
+}
+
+// Parse a sysfs cpulist ("0-3,8,10-11") into a cpu_set_t
+static inline int placement_read_cpulist(const char* path, cpu_set_t* set) {
+    char buf[4096];
+    FILE* f = fopen(path, "r");
+    CPU_ZERO(set);
+    if (!f)
+        return -1;
+    if (!fgets(buf, sizeof(buf), f)) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    for (char* p = buf; *p && *p != '\n'; ) {
+        char* end;
+        long lo = strtol(p, &end, 10), hi = lo;
+        if (end == p)
+            break;
+        if (*end == '-')
+            hi = strtol(end + 1, &end, 10);
+        for (long c = lo; c <= hi && c < CPU_SETSIZE; c++)
+            CPU_SET(c, set);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return 0;
+}
+
+static inline int placement_cmp_compact(const void* a, const void* b) {
+    const struct placement_cpu* x = &placement.cpus[*(const int*)a];
+    const struct placement_cpu* y = &placement.cpus[*(const int*)b];
+    if (x->node != y->node) return x->node - y->node;
+    if (x->smt != y->smt) return x->smt - y->smt;
+    if (x->package != y->package) return x->package - y->package;
+    if (x->core != y->core) return x->core - y->core;
+    return x->cpu - y->cpu;
+}
+
+static inline int placement_cmp_smt_pairs(const void* a, const void* b) {
+    const struct placement_cpu* x = &placement.cpus[*(const int*)a];
+    const struct placement_cpu* y = &placement.cpus[*(const int*)b];
+    if (x->node != y->node) return x->node - y->node;
+    if (x->package != y->package) return x->package - y->package;
+    if (x->core != y->core) return x->core - y->core;
+    return x->smt - y->smt;
+}
+
+// Fill placement.slot[] from placement.cpus[] for the current policy
+static inline void placement_order(void) {
+    placement.nslots = 0;
+    for (int i = 0; i < placement.ncpus; i++)
+        if (placement.policy != PLACE_ONE_PER_CORE || placement.cpus[i].smt == 0)
+            placement.slot[placement.nslots++] = i;
+    qsort(placement.slot, placement.nslots, sizeof(int),
+          placement.policy == PLACE_SMT_PAIRS ? placement_cmp_smt_pairs : placement_cmp_compact);
+
+    if (placement.policy == PLACE_SCATTER) {
+        // deal the compact order out one CPU per node per round
+        int order[CPU_SETSIZE], n = 0;
+        int next[PLACEMENT_MAX_NODES] = { 0 };
+        while (n < placement.nslots) {
+            for (int node = 0; node < PLACEMENT_MAX_NODES; node++) {
+                while (next[node] < placement.nslots &&
+                       placement.cpus[placement.slot[next[node]]].node != node)
+                    next[node]++;
+                if (next[node] < placement.nslots)
+                    order[n++] = placement.slot[next[node]++];
+            }
+        }
+        memcpy(placement.slot, order, n * sizeof(int));
+    }
+}
+
+// Returns -1 for an unknown policy name
+static inline int placement_init(const char* policy) {
+    char path[128];
+    cpu_set_t allowed;
+    int p;
+
+    for (p = 0; p <= PLACE_NONE; p++)
+        if (strcmp(policy, placement_names[p]) == 0)
+            break;
+    if (p > PLACE_NONE)
+        return -1;
+    placement.policy = (enum placement_policy)p;
+    placement_policy_name = placement_names[p];
+
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        CPU_SET(0, &allowed);
+
+    int node_of[CPU_SETSIZE];
+    for (int c = 0; c < CPU_SETSIZE; c++)
+        node_of[c] = 0;
+    for (int n = 0; n < PLACEMENT_MAX_NODES; n++) {
+        cpu_set_t set;
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", n);
+        if (placement_read_cpulist(path, &set) != 0)
+            continue;
+        for (int c = 0; c < CPU_SETSIZE; c++)
+            if (CPU_ISSET(c, &set))
+                node_of[c] = n;
+    }
+
+    placement.ncpus = 0;
+    for (int n = 0; n < PLACEMENT_MAX_NODES; n++)
+        CPU_ZERO(&placement.node_mask[n]);
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (!CPU_ISSET(c, &allowed))
+            continue;
+        struct placement_cpu* pc = &placement.cpus[placement.ncpus++];
+        pc->cpu = c;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", c);
+        pc->core = placement_read_int(path, c);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", c);
+        pc->package = placement_read_int(path, 0);
+        pc->node = node_of[c];
+        pc->smt = 0;
+        for (int i = 0; i < placement.ncpus - 1; i++)
+            if (placement.cpus[i].core == pc->core && placement.cpus[i].package == pc->package)
+                pc->smt++;
+        CPU_SET(c, &placement.node_mask[pc->node]);
+    }
+
+    placement_order();
+    return 0;
+}
+
+static inline int placement_cpu_of(int thread_index) {
+    if (placement.nslots == 0)
+        return -1;
+    return placement.cpus[placement.slot[thread_index % placement.nslots]].cpu;
+}
+
+// NUMA node of `cpu`, 0 if it is not one of the allowed CPUs
+static inline int placement_node_of_cpu(int cpu) {
+    for (int i = 0; i < placement.ncpus; i++)
+        if (placement.cpus[i].cpu == cpu)
+            return placement.cpus[i].node;
+    return 0;
+}
+
+// Pin the calling thread; a no-op for "none"
+static inline int placement_pin(int thread_index) {
+    cpu_set_t cpuset;
+    int cpu = placement_cpu_of(thread_index);
+    if (placement.policy == PLACE_NONE || cpu < 0)
+        return 0;
+    if (placement.policy == PLACE_PER_NUMA_NODE) {
+        cpuset = placement.node_mask[placement.cpus[placement.slot[thread_index % placement.nslots]].node];
+    } else {
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+// "# placement=compact threads=4 map=0:0,1:2,..."; node numbers as nN for
+// per-numa-node, " oversubscribed=<threads per slot>x" once threads wrap
+static inline void placement_log(FILE* out, int num_threads) {
+    fprintf(out, "# placement=%s threads=%d map=", placement_policy_name, num_threads);
+    for (int t = 0; t < num_threads; t++) {
+        int cpu = placement_cpu_of(t);
+        if (placement.policy == PLACE_NONE || cpu < 0)
+            fprintf(out, "%s%d:-", t ? "," : "", t);
+        else if (placement.policy == PLACE_PER_NUMA_NODE)
+            fprintf(out, "%s%d:n%d", t ? "," : "", t,
+                    placement.cpus[placement.slot[t % placement.nslots]].node);
+        else
+            fprintf(out, "%s%d:%d", t ? "," : "", t, cpu);
+    }
+    if (placement.nslots > 0 && num_threads > placement.nslots)
+        fprintf(out, " oversubscribed=%.2fx", (double)num_threads / placement.nslots);
+    fprintf(out, "\n");
+}
+
+// Pull --placement=<policy> out of argv (any position), initialise the
+// table and exit with a message on an unknown policy.
+static inline void placement_parse(int* argc, char** argv) {
+    const char* policy = "compact";
+    int out = 1;
+    for (int i = 1; i < *argc; i++) {
+        if (strncmp(argv[i], "--placement=", 12) == 0)
+            policy = argv[i] + 12;
+        else
+            argv[out++] = argv[i];
+    }
+    argv[out] = NULL;
+    *argc = out;
+    if (placement_init(policy) != 0) {
+        fprintf(stderr, "Error: unknown placement '%s' (compact, scatter, smt-pairs, "
+                "one-per-core, per-numa-node, none)\n", policy);
+        exit(1);
+    }
+}
+
+#endif // PLACEMENT_H
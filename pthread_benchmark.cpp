@@ -3,6 +3,10 @@
 #include<cstdlib>
 #include<pthread.h>
 #include<sys/time.h>
+#include "bench_stop.h"
+#include "placement.h"
+#include "perf_counters.h"
+#include "cpu_usage.h"
 
 #ifdef SHIELD_A
 #include "shielding_array.h"
@@ -11,18 +15,18 @@
 #ifdef SHIELD_H
 #include "shielding_hash.h"
 #endif
+#include "qlock_select.h"     // last: -DQLOCK_* swaps pthread_mutex_t for a queue lock
 #define FLAG false
 using namespace std;
 
 #define NUM_ITERATIONS 1000000000
 #define NUM_WARMUPITERATIONS 10000
-// CPU ranges
-#define CPU_RANGE1_START 64
-#define CPU_RANGE1_END 127
-#define CPU_RANGE2_START 192
-#define CPU_RANGE2_END 255
 
 int numWorkers;
+double run_seconds = 0;     // > 0: --duration=<sec> run instead of NUM_ITERATIONS
+long long* ops_completed;
+struct perf_group* perf_groups;    // one per thread, used with --perf
+struct cpu_usage* cpu_usages;      // one per thread, used with --cpu
 
 #ifdef RWLOCK
 pthread_rwlock_t mylock;
@@ -32,18 +36,9 @@ pthread_mutex_t mylock;
 pthread_barrier_t my_barrier;
 struct timeval timeStart, timeEnd;
 
+// Pin the calling thread according to --placement (placement.h)
 void set_cpu_affinity(int thread_index) {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    
-    int cpu_id;
-    if (thread_index < 64) {
-        cpu_id =  CPU_RANGE1_START + thread_index;
-    } else {
-        cpu_id =  CPU_RANGE2_START + (thread_index - 64);
-    }
-    CPU_SET(cpu_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    placement_pin(thread_index);
 }
 
 /*void* warmupFunction(void* arg) {
@@ -62,6 +57,7 @@ void* mainThreadFunction(void* arg) {
     //long args = (long)arg;
     long thread_index = *(long*)arg;
     set_cpu_affinity(thread_index);
+    perf_group_open(&perf_groups[thread_index]);
     // Main timed phase
 
     // Calculate iterations per thread
@@ -86,10 +82,16 @@ void* mainThreadFunction(void* arg) {
 #endif
     }
     pthread_barrier_wait(&my_barrier);
-    if(thread_index == 0)
+    if(thread_index == 0) {
 	gettimeofday(&timeStart, 0);
+        if (run_seconds > 0)
+            bench_stop_start(run_seconds);
+    }
+    perf_group_start(&perf_groups[thread_index]);
+    cpu_usage_start(&cpu_usages[thread_index]);
 
-    for (long i = 0; i < iterations_per_thread; i++) {
+    long long i;
+    for (i = 0; run_seconds > 0 ? !bench_should_stop() : i < iterations_per_thread; i++) {
 #if defined(SHIELD_A) || defined(SHIELD_H)
         LS_ACQUIRE(&mylock, FLAG, pthread_mutex_lock);
         LS_RELEASE(&mylock, FLAG, pthread_mutex_unlock);
@@ -102,6 +104,9 @@ void* mainThreadFunction(void* arg) {
         pthread_mutex_unlock(&mylock);
 #endif
     }
+    perf_group_stop(&perf_groups[thread_index]);
+    cpu_usage_stop(&cpu_usages[thread_index]);
+    ops_completed[thread_index] = i;
      pthread_barrier_wait(&my_barrier);
      if(thread_index == 0)
          gettimeofday(&timeEnd, 0);
@@ -109,8 +114,13 @@ void* mainThreadFunction(void* arg) {
 }
 
 int main(int argc, char* argv[]){
+    run_seconds = bench_parse_duration(&argc, argv);
+    placement_parse(&argc, argv);
+    perf_parse(&argc, argv);
+    cpu_usage_parse(&argc, argv);
+    qlock_parse(&argc, argv);
     if(argc != 2) {
-        printf("usage:./<exe> <num_threads>\n");
+        printf("usage:./<exe> <num_threads> [--duration=<sec>] [--placement=<policy>] [--perf] [--cpu]\n");
         exit(0);
     }
 
@@ -139,9 +149,16 @@ int main(int argc, char* argv[]){
 	long long elapsed=0;
 	//initializing number of workers.
 	numWorkers=atoi(argv[1]);
+	placement_log(stderr, numWorkers);
 	pthread_t Threads[numWorkers];
     pthread_barrier_init(&my_barrier,NULL, numWorkers);    
 	long thread_indices[numWorkers];    
+	long long ops[numWorkers];
+	ops_completed = ops;
+	struct perf_group perf[numWorkers];
+	struct cpu_usage cpu_use[numWorkers];
+	perf_groups = perf;
+	cpu_usages = cpu_use;
 	// struct timeval timeStart, timeEnd;
 
 	// printf("Num of thread:%d\n",numWorkers);
@@ -154,9 +171,12 @@ int main(int argc, char* argv[]){
     }
 
     // Wait for main threads to finish
+    long long total_ops = 0;
     for (int i = 0; i < numWorkers; i++) {
         pthread_join(Threads[i], nullptr);
+        total_ops += ops_completed[i];
     }
+    bench_stop_join();
 	
 	// gettimeofday(&timeEnd, 0);
 	elapsed = (timeEnd.tv_sec-timeStart.tv_sec)*1000000LL + timeEnd.tv_usec-timeStart.tv_usec;
@@ -169,7 +189,10 @@ int main(int argc, char* argv[]){
 #endif
     	pthread_barrier_destroy(&my_barrier);    
 	//printf ("\nDone.	%f	sec\n",elapsed/(double)1000000);
-	printf ("%d,%f,%f\n",numWorkers, elapsed/(double)1000000, NUM_ITERATIONS/(elapsed/(double)1000000));
+	printf ("%d,%f,%f",numWorkers, elapsed/(double)1000000, total_ops/(elapsed/(double)1000000));
+	perf_print_columns(stdout, perf, numWorkers, total_ops);
+	cpu_usage_print_columns(stdout, cpu_use, numWorkers, total_ops);
+	printf ("\n");
 	return 0;
 }
 
@@ -1,28 +1,10 @@
 #!/bin/bash
 pwd; hostname; date
-g++ -O3 pthread_benchmark.cpp -o pthread_benchmark_normal -lpthread
+# every pthread_benchmark / mutex_bench / omp_bench / boost_bench variant is a
+# lockbench backend now; ./lockbench --list shows which -D build each replaces
+g++ -O3 -std=c++17 lockbench.cpp -o lockbench -lpthread -fopenmp
 
-g++ -O3 pthread_benchmark.cpp -o pthread_benchmark_reentrant -lpthread -DRECURSIVE
-
-g++ -O3 pthread_benchmark.cpp -o pthread_benchmark_errorcheck -lpthread -DERRORCHECK
-
-g++ -O3 pthread_benchmark.cpp -o pthread_benchmark_shield_hash_re -lpthread -DSHIELD_H
-
-g++ -O3 pthread_benchmark.cpp -o pthread_benchmark_shield_array_re -lpthread -DSHIELD_A
-
-g++ -O3 pthread_benchmark.cpp -o pthread_benchmark_rwlock -lpthread -DRWLOCK
-
-g++ -O3 omp_bench.cpp -o omp_bench -fopenmp
-
-g++ -O3 omp_bench.cpp -o omp_bench_nested -DNESTED -fopenmp
-
-g++ -O3 mutex_bench.cpp -o mutex_bench_recur -DNESTED
-
-g++ -O3 mutex_bench.cpp -o mutex_bench
-
-g++ -O3 mutex_bench.cpp -o mutex_bench_shield -DSHIELD_A
-
-g++ -O3 mutex_bench.cpp -o mutex_bench_rw -DRW
+g++ -O3 -std=c++17 runbench.cpp -o runbench
 
 g++ -std=c++11 -O3 -o pthread_rwbenchmark pthread_rwbench.cpp -lpthread
 
@@ -30,20 +12,20 @@ g++ -std=c++11 -O3 -o pthread_rwbenchmark pthread_rwbench.cpp -lpthread
 
 for i in {1..10}
 	do
-#	./pthread_benchmark_normal 1 >>results/pthread_benchmark_normal1.csv
-#	./pthread_benchmark_reentrant 1 >>results/pthread_benchmark_reentrant1.csv
-#	./pthread_benchmark_errorcheck 1 >>results/pthread_benchmark_errorcheck1.csv
-#	./pthread_benchmark_shield_array_re 1 >>results/pthread_benchmark_shield_a_re1.csv
-#	./pthread_benchmark_shield_hash_re 1 >>results/pthread_benchmark_shield_h_re1.csv
-#	./omp_bench 1 >>results/omp_bench1.csv
-#	./omp_bench_nested 1 >>results/omp_bench_nested1.csv
-#	./mutex_bench_recur 1 >>results/mutex_bench_recur1.csv
-#	./mutex_bench 1 >>results/mutex_bench1.csv
-	./../../litl/libmcs_spinlock.sh ./pthread_benchmark_normal 1 >>results/mcs_pthread1.csv
-	./../../PLiTL/libmcs_spinlock.sh ./pthread_benchmark_normal 1 >>results/mcs_pthread_pid1.csv
-	./../../SLiTL/libmcs_spinlock.sh ./pthread_benchmark_normal 1 >>results/mcs_pthread_arr1.csv
-       ./../../ELiTL/libmcs_spinlock.sh ./pthread_benchmark_normal 1 >>results/mcs_pthread_hash1.csv
-#	./pthread_benchmark_shield 3
+#	for lock in pthread pthread-recursive pthread-errorcheck pthread-shield omp omp-nested std-recursive std std-shield
+#		do
+#		./lockbench --lock=$lock --threads=1 >>results/lockbench_${lock}1.csv
+#		done
+#	./lockbench --lock=pthread --threads=64 --cs-work=100 --sample=64 >>results/lockbench_pthread_latency64.csv
+#	./lockbench --lock=pthread --threads=64 --cs-work=100 --duration=5 --fairness >>results/lockbench_pthread_fairness64.csv 2>>results/lockbench_pthread_fairness64_threads.csv
+#	./lockbench --lock=pthread --threads=64 --duration=5 --perf >>results/lockbench_pthread_perf64.csv
+#	./runbench --metric=6 --samples=results/lockbench_pthread64_samples.csv -- ./lockbench --lock=pthread --threads=64 >>results/lockbench_pthread64_summary.csv
+#	# open-loop, oversubscription, NUMA, handoff, combining, futex, biased, RW and seqlock sweeps: ./lockbench_sweeps.sh
+	# built-in queue locks (queue_locks.h) instead of the external LiTL MCS wrappers
+	for lock in mcs mcs-park clh clh-park hemlock hemlock-park
+		do
+		./lockbench --lock=$lock --threads=1 >>results/lockbench_${lock}1.csv
+		done
 	done
 date
 
@@ -0,0 +1,142 @@
+#ifndef QLOCK_SELECT_H
+#define QLOCK_SELECT_H
+
+// Compile-time queue-lock selection for the pthread_mutex_t harnesses:
+//   -DQLOCK_MCS, -DQLOCK_CLH or -DQLOCK_HEMLOCK   replace pthread_mutex_t
+//   -DQLOCK_PARK                                  spin-then-park variant
+//   -DQLOCK_CBOMCS or -DQLOCK_HMCS                NUMA cohort lock (numa_locks.h),
+//                                                 spin only, batch bound -DNUMA_LOCK_BATCH=<n>
+//   -DQLOCK_FUTEX                                 raw three-state futex mutex (futex_mutex.h);
+//                                                 --futex-spin/--futex-wake/--futex-pause
+//   -DQLOCK_PARKING_LOT                           one-byte lock over a global parking lot
+//                                                 (parking_lot.h)
+// Without any of them this header only defines qlock_parse(&argc, argv),
+// which the harnesses call to pull the lock's own options out of argv (a
+// no-op unless the lock has some), and the hand-over counters of the
+// cohort locks: a worker calls qlock_handoffs_collect() once its measured
+// run is over, and qlock_handoffs_print_columns(out) appends
+// ",intra_node_handoffs,inter_node_handoffs,intra_ratio" to the CSV line
+// (both no-ops for the other locks).
+//
+// It renames pthread_mutex_t and pthread_mutex_{init,lock,unlock,destroy}
+// for the rest of the file, so it has to be the last include.  The
+// functions take void* so that LS_ACQUIRE/LS_RELEASE, which cast the lock
+// to pthread_mutex_t*, can still be handed pthread_mutex_lock/unlock.
+// Queue locks are not reentrant: a recursive mutexattr is refused, nest
+// through the shield instead (-DSHIELD_A -DFLAG=true).
+
+#if defined(QLOCK_MCS) + defined(QLOCK_CLH) + defined(QLOCK_HEMLOCK) + \
+    defined(QLOCK_CBOMCS) + defined(QLOCK_HMCS) + defined(QLOCK_FUTEX) + defined(QLOCK_PARKING_LOT) > 1
+#error "pick one of QLOCK_MCS, QLOCK_CLH, QLOCK_HEMLOCK, QLOCK_CBOMCS, QLOCK_HMCS, QLOCK_FUTEX, QLOCK_PARKING_LOT"
+#endif
+
+#if defined(QLOCK_MCS) || defined(QLOCK_CLH) || defined(QLOCK_HEMLOCK) || \
+    defined(QLOCK_CBOMCS) || defined(QLOCK_HMCS) || defined(QLOCK_FUTEX) || defined(QLOCK_PARKING_LOT)
+
+#include <pthread.h>
+#include "queue_locks.h"
+#if defined(QLOCK_CBOMCS) || defined(QLOCK_HMCS)
+#include "numa_locks.h"
+#endif
+#ifdef QLOCK_FUTEX
+#include "futex_mutex.h"
+#endif
+#ifdef QLOCK_PARKING_LOT
+#include "parking_lot.h"
+#endif
+
+#ifdef QLOCK_PARK
+#define QLOCK_PARK_MODE 1
+#else
+#define QLOCK_PARK_MODE 0
+#endif
+
+#if defined(QLOCK_MCS)
+typedef mcs_lock_t qlock_t;
+#define QLOCK_FN(op) mcs_##op
+#define QLOCK_INIT(l) mcs_init(l, QLOCK_PARK_MODE)
+#elif defined(QLOCK_CLH)
+typedef clh_lock_t qlock_t;
+#define QLOCK_FN(op) clh_##op
+#define QLOCK_INIT(l) clh_init(l, QLOCK_PARK_MODE)
+#elif defined(QLOCK_HEMLOCK)
+typedef hemlock_t qlock_t;
+#define QLOCK_FN(op) hemlock_##op
+#define QLOCK_INIT(l) hemlock_init(l, QLOCK_PARK_MODE)
+#elif defined(QLOCK_FUTEX)
+typedef futex_mutex_t qlock_t;
+#define QLOCK_FN(op) futex_mutex_##op
+#define QLOCK_INIT(l) futex_mutex_init(l)
+#elif defined(QLOCK_PARKING_LOT)
+typedef pl_lock_t qlock_t;
+#define QLOCK_FN(op) pl_##op
+#define QLOCK_INIT(l) pl_init(l)
+#elif defined(QLOCK_CBOMCS)
+typedef cbomcs_lock_t qlock_t;
+#define QLOCK_FN(op) cbomcs_##op
+#define QLOCK_INIT(l) cbomcs_init(l)
+#else
+typedef hmcs_lock_t qlock_t;
+#define QLOCK_FN(op) hmcs_##op
+#define QLOCK_INIT(l) hmcs_init(l)
+#endif
+
+static inline int qlock_init(void* l, const pthread_mutexattr_t* attr) {
+    int type;
+    if (attr && pthread_mutexattr_gettype(attr, &type) == 0 && type == PTHREAD_MUTEX_RECURSIVE) {
+        fprintf(stderr, "queue and futex locks are not reentrant; nest through the shield instead\n");
+        exit(1);
+    }
+    QLOCK_INIT((qlock_t*)l);
+    return 0;
+}
+
+static inline int qlock_lock(void* l) {
+    QLOCK_FN(lock)((qlock_t*)l);
+    return 0;
+}
+
+static inline int qlock_unlock(void* l) {
+    QLOCK_FN(unlock)((qlock_t*)l);
+    return 0;
+}
+
+static inline int qlock_destroy(void* l) {
+    QLOCK_FN(destroy)((qlock_t*)l);
+    return 0;
+}
+
+#define pthread_mutex_t qlock_t
+#define pthread_mutex_init qlock_init
+#define pthread_mutex_lock qlock_lock
+#define pthread_mutex_unlock qlock_unlock
+#define pthread_mutex_destroy qlock_destroy
+
+#endif
+
+#ifdef QLOCK_FUTEX
+#define qlock_parse futex_mutex_parse
+#else
+#define qlock_parse(argc, argv) ((void)0)
+#endif
+
+#if defined(QLOCK_CBOMCS) || defined(QLOCK_HMCS)
+static uint64_t qlock_intra_handoffs, qlock_inter_handoffs;
+
+// Add the calling thread's hand-overs to the totals
+static inline void qlock_handoffs_collect(void) {
+    __atomic_add_fetch(&qlock_intra_handoffs, numa_intra_handoffs, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&qlock_inter_handoffs, numa_inter_handoffs, __ATOMIC_RELAXED);
+}
+
+static inline void qlock_handoffs_print_columns(FILE* out) {
+    uint64_t all = qlock_intra_handoffs + qlock_inter_handoffs;
+    fprintf(out, ",%llu,%llu,%f", (unsigned long long)qlock_intra_handoffs,
+            (unsigned long long)qlock_inter_handoffs, all ? (double)qlock_intra_handoffs / all : 0.0);
+}
+#else
+#define qlock_handoffs_collect() ((void)0)
+#define qlock_handoffs_print_columns(out) ((void)0)
+#endif
+
+#endif // QLOCK_SELECT_H
@@ -0,0 +1,279 @@
+#ifndef QUEUE_LOCKS_H
+#define QUEUE_LOCKS_H
+
+// Built-in MCS, CLH and Hemlock queue locks, so the queue-lock results no
+// longer depend on the external LiTL interposition libraries.
+//
+// Every lock takes a `park` flag at init: 0 spins until the lock is handed
+// over, 1 spins QL_SPIN_LIMIT times and then sleeps on a futex until the
+// predecessor wakes it.  The hand-over word of the parking variants is
+//   0 waiting, 1 granted, 2 waiter asleep in the kernel
+// so the releaser only pays for FUTEX_WAKE when somebody actually slept.
+//
+// MCS and CLH queue nodes come from a per-thread free list and the owner
+// keeps its node in the lock, so the pthread-style lock()/unlock() calls
+// need no extra argument and a thread can hold any number of locks (the
+// hierarchical harnesses).  Nodes are cache-line sized and are never
+// given back to the allocator: a releaser may still issue FUTEX_WAKE on a
+// node its successor has already recycled, which is harmless as long as
+// the memory stays mapped.  Hemlock needs just one element per thread,
+// whatever the number of locks held.
+//
+// None of them is reentrant; nest through the LockShield wrapper.
+//
+// Plain C so the .c harnesses can include it as well.
+
+#include <limits.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef QL_SPIN_LIMIT
+#define QL_SPIN_LIMIT 1024      // pause iterations before parking / yielding
+#endif
+
+static inline void ql_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Spin for a while, then let the thread we are waiting for run
+static inline void ql_backoff(int* spins) {
+    if (++*spins < QL_SPIN_LIMIT)
+        ql_pause();
+    else
+        sched_yield();
+}
+
+static inline void ql_futex_wait(int* w, int val) {
+    syscall(SYS_futex, w, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static inline void ql_futex_wake(int* w, int n) {
+    syscall(SYS_futex, w, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+// Sleep on the hand-over word `w` until it is granted
+static inline void ql_sleep(int* w) {
+    int expected = 0;
+    __atomic_compare_exchange_n(w, &expected, 2, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE);
+    while (__atomic_load_n(w, __ATOMIC_ACQUIRE) != 1)
+        ql_futex_wait(w, 2);
+}
+
+// Wait until the hand-over word `w` is granted
+static inline void ql_wait(int* w, int park) {
+    int spins = 0;
+    while (__atomic_load_n(w, __ATOMIC_ACQUIRE) != 1) {
+        if (park && ++spins >= QL_SPIN_LIMIT) {
+            ql_sleep(w);
+            return;
+        }
+        ql_pause();
+    }
+}
+
+static inline void ql_grant(int* w, int park) {
+    if (!park)
+        __atomic_store_n(w, 1, __ATOMIC_RELEASE);
+    else if (__atomic_exchange_n(w, 1, __ATOMIC_RELEASE) == 2)
+        ql_futex_wake(w, 1);
+}
+
+struct ql_node {
+    struct ql_node* next;       // MCS successor; free-list link while pooled
+    int granted;                // hand-over word, see above
+} __attribute__((aligned(64)));
+
+static __thread struct ql_node* ql_pool;
+
+static inline struct ql_node* ql_node_get(void) {
+    struct ql_node* n = ql_pool;
+    if (n) {
+        ql_pool = n->next;
+        return n;
+    }
+    n = (struct ql_node*)aligned_alloc(64, sizeof(struct ql_node));
+    if (!n) {
+        perror("aligned_alloc");
+        exit(1);
+    }
+    return n;
+}
+
+static inline void ql_node_put(struct ql_node* n) {
+    n->next = ql_pool;
+    ql_pool = n;
+}
+
+// MCS: waiters spin on their own node, the releaser hands over to next
+
+typedef struct {
+    struct ql_node* tail;
+    struct ql_node* holder;     // node of the current owner
+    int park;
+} mcs_lock_t;
+
+static inline void mcs_init(mcs_lock_t* l, int park) {
+    l->tail = NULL;
+    l->holder = NULL;
+    l->park = park;
+}
+
+static inline void mcs_destroy(mcs_lock_t* l) {
+    (void)l;
+}
+
+static inline void mcs_lock(mcs_lock_t* l) {
+    struct ql_node* me = ql_node_get();
+    me->next = NULL;
+    me->granted = 0;
+    struct ql_node* pred = __atomic_exchange_n(&l->tail, me, __ATOMIC_ACQ_REL);
+    if (pred) {
+        __atomic_store_n(&pred->next, me, __ATOMIC_RELEASE);
+        ql_wait(&me->granted, l->park);
+    }
+    l->holder = me;
+}
+
+static inline void mcs_unlock(mcs_lock_t* l) {
+    struct ql_node* me = l->holder;
+    struct ql_node* next = __atomic_load_n(&me->next, __ATOMIC_ACQUIRE);
+    if (!next) {
+        struct ql_node* expected = me;
+        if (__atomic_compare_exchange_n(&l->tail, &expected, NULL, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            ql_node_put(me);
+            return;
+        }
+        // a successor swapped itself in but has not linked up yet
+        int spins = 0;
+        while (!(next = __atomic_load_n(&me->next, __ATOMIC_ACQUIRE)))
+            ql_backoff(&spins);
+    }
+    ql_grant(&next->granted, l->park);
+    ql_node_put(me);
+}
+
+// CLH: waiters spin on their predecessor's node and take it over once the
+// lock is theirs, so nodes migrate between threads
+
+typedef struct {
+    struct ql_node* tail;
+    struct ql_node* holder;
+    int park;
+} clh_lock_t;
+
+static inline void clh_init(clh_lock_t* l, int park) {
+    struct ql_node* dummy = ql_node_get();
+    dummy->granted = 1;
+    l->tail = dummy;
+    l->holder = NULL;
+    l->park = park;
+}
+
+static inline void clh_destroy(clh_lock_t* l) {
+    free(l->tail);
+    l->tail = NULL;
+}
+
+static inline void clh_lock(clh_lock_t* l) {
+    struct ql_node* me = ql_node_get();
+    me->granted = 0;
+    struct ql_node* pred = __atomic_exchange_n(&l->tail, me, __ATOMIC_ACQ_REL);
+    ql_wait(&pred->granted, l->park);
+    ql_node_put(pred);
+    l->holder = me;
+}
+
+static inline void clh_unlock(clh_lock_t* l) {
+    ql_grant(&l->holder->granted, l->park);
+}
+
+// Hemlock (Dice & Kogan): one element per thread; the releaser publishes
+// the lock address in its own element and waits for the successor to
+// acknowledge, so the element can serve every lock the thread holds.
+
+struct hemlock_elem {
+    void* grant;                // lock handed to the successor; NULL once acked
+    int gen;                    // futex word, bumped on every hand-over
+    int parked;                 // successors asleep on gen
+} __attribute__((aligned(64)));
+
+static __thread struct hemlock_elem hemlock_self;
+
+typedef struct {
+    struct hemlock_elem* tail;
+    int park;
+} hemlock_t;
+
+static inline void hemlock_init(hemlock_t* l, int park) {
+    l->tail = NULL;
+    l->park = park;
+}
+
+static inline void hemlock_destroy(hemlock_t* l) {
+    (void)l;
+}
+
+// Sleep until `pred` hands `l` over; pred bumps gen after publishing the
+// grant and wakes everyone parked on it
+static inline void hemlock_sleep(struct hemlock_elem* pred, hemlock_t* l) {
+    for (;;) {
+        int gen = __atomic_load_n(&pred->gen, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&pred->parked, 1, __ATOMIC_SEQ_CST);
+        int granted = __atomic_load_n(&pred->grant, __ATOMIC_SEQ_CST) == l;
+        if (!granted)
+            ql_futex_wait(&pred->gen, gen);
+        __atomic_sub_fetch(&pred->parked, 1, __ATOMIC_SEQ_CST);
+        if (granted || __atomic_load_n(&pred->grant, __ATOMIC_ACQUIRE) == l)
+            return;
+    }
+}
+
+static inline void hemlock_wait(struct hemlock_elem* pred, hemlock_t* l) {
+    int spins = 0;
+    while (__atomic_load_n(&pred->grant, __ATOMIC_ACQUIRE) != l) {
+        if (l->park && ++spins >= QL_SPIN_LIMIT) {
+            hemlock_sleep(pred, l);
+            return;
+        }
+        ql_pause();
+    }
+}
+
+static inline void hemlock_lock(hemlock_t* l) {
+    struct hemlock_elem* self = &hemlock_self;
+    struct hemlock_elem* pred = __atomic_exchange_n(&l->tail, self, __ATOMIC_ACQ_REL);
+    if (pred) {
+        hemlock_wait(pred, l);
+        __atomic_store_n(&pred->grant, (void*)NULL, __ATOMIC_RELEASE);    // ack
+    }
+}
+
+static inline void hemlock_unlock(hemlock_t* l) {
+    struct hemlock_elem* self = &hemlock_self;
+    struct hemlock_elem* expected = self;
+    if (__atomic_compare_exchange_n(&l->tail, &expected, NULL, 0,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        return;
+    if (l->park) {
+        __atomic_store_n(&self->grant, (void*)l, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&self->gen, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&self->parked, __ATOMIC_SEQ_CST))
+            ql_futex_wake(&self->gen, INT_MAX);
+    } else {
+        __atomic_store_n(&self->grant, (void*)l, __ATOMIC_RELEASE);
+    }
+    int spins = 0;
+    while (__atomic_load_n(&self->grant, __ATOMIC_ACQUIRE) != NULL)
+        ql_backoff(&spins);
+}
+
+#endif // QUEUE_LOCKS_H
@@ -0,0 +1,375 @@
+// runbench: repeat one benchmark configuration until its result is stable
+// and summarise it, instead of appending raw lines to a results file.
+//
+//   ./runbench [--min-runs=<n>] [--max-runs=<n>] [--ci=<rel>] [--metric=<col>]
+//              [--samples=<file>] -- <benchmark> <args...>
+//
+// The benchmark is run at least --min-runs times (default 5) and at most
+// --max-runs times (default 30), stopping once the 95% confidence interval
+// of the mean is within --ci of it (default 0.02 = +-2%).  --metric is the
+// 1-based CSV column of the benchmark's last stdout line to analyse
+// (default 3, ops/sec of pthread_benchmark / mutex_bench / omp_bench and
+// friends; use 6 for lockbench).
+//
+// Every sample also records the placement line the harness logged on
+// stderr, the CPU frequency governor and the number of CPU migrations of
+// the run (a software perf counter inherited by all its threads); with
+// --samples they are written there one per line:
+//   run,value,cluster,outlier,governor,migrations,placement
+//
+// The samples are split into clusters wherever sorting them leaves a gap
+// that is large against the spread inside the clusters, so a bimodal
+// configuration shows up as two clusters rather than one wide interval.
+// When that happens the stopping rule applies to every cluster instead.
+// Outliers are values outside the Tukey fences (1.5 IQR) of their cluster.
+//
+// Output, one line on stdout:
+//   runs,median,q1,q3,iqr,mean,ci95_rel,clusters,outliers,cluster_medians
+// with cluster_medians as median@count pairs separated by ';'.
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<math.h>
+#include<unistd.h>
+#include<poll.h>
+#include<sched.h>
+#include<stdint.h>
+#include<sys/wait.h>
+#include<sys/syscall.h>
+#include<linux/perf_event.h>
+#include<string>
+#include<vector>
+#include<algorithm>
+
+using namespace std;
+
+#define DEFAULT_MIN_RUNS 5
+#define DEFAULT_MAX_RUNS 30
+#define DEFAULT_CI 0.02
+#define DEFAULT_METRIC 3
+#define MAX_CLUSTERS 4
+// a gap splits two clusters when it exceeds this many pooled stddevs ...
+#define SPLIT_SIGMAS 4.0
+// ... and this fraction of the lower cluster's mean
+#define SPLIT_REL 0.05
+
+struct Sample {
+    double value;
+    int cluster;
+    bool outlier;
+    string governor;
+    long long migrations;   // -1 when the counter is unavailable
+    string placement;
+};
+
+struct RunOutput {
+    string out, err;
+    int status;
+    long long migrations;
+};
+
+// Two-sided 95% Student t quantiles for 1..30 degrees of freedom
+static double t95(int df) {
+    static const double t[] = { 0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365,
+        2.306, 2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101,
+        2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+    if (df < 1)
+        return INFINITY;
+    return df <= 30 ? t[df] : 1.96;
+}
+
+static double mean_of(const vector<double>& v) {
+    double s = 0;
+    for (double x : v) s += x;
+    return v.empty() ? 0 : s / v.size();
+}
+
+static double stddev_of(const vector<double>& v) {
+    if (v.size() < 2)
+        return 0;
+    double m = mean_of(v), s = 0;
+    for (double x : v) s += (x - m) * (x - m);
+    return sqrt(s / (v.size() - 1));
+}
+
+// Linear-interpolated quantile of sorted values
+static double quantile(const vector<double>& sorted, double q) {
+    if (sorted.empty())
+        return 0;
+    double pos = q * (sorted.size() - 1);
+    size_t lo = (size_t)pos;
+    if (lo + 1 >= sorted.size())
+        return sorted.back();
+    return sorted[lo] + (pos - lo) * (sorted[lo + 1] - sorted[lo]);
+}
+
+// Half-width of the 95% CI of the mean, relative to the mean
+static double ci_rel(const vector<double>& v) {
+    double m = mean_of(v);
+    if (v.size() < 2 || m == 0)
+        return INFINITY;
+    return t95(v.size() - 1) * stddev_of(v) / sqrt((double)v.size()) / fabs(m);
+}
+
+// Split sorted values [lo,hi) at its widest gap while that gap stands out
+// against the spread inside both halves; cut[] collects the split points.
+static void split_clusters(const vector<double>& s, size_t lo, size_t hi, vector<size_t>& cut) {
+    size_t min_size = max((size_t)2, s.size() / 10);
+    if (hi - lo < 2 * min_size || cut.size() + 1 >= MAX_CLUSTERS)
+        return;
+    size_t best = 0;
+    double gap = 0;
+    for (size_t i = lo + min_size; i <= hi - min_size; i++)
+        if (s[i] - s[i - 1] > gap) {
+            gap = s[i] - s[i - 1];
+            best = i;
+        }
+    if (best == 0)
+        return;
+    vector<double> a(s.begin() + lo, s.begin() + best), b(s.begin() + best, s.begin() + hi);
+    double pooled = sqrt((stddev_of(a) * stddev_of(a) * (a.size() - 1) +
+                          stddev_of(b) * stddev_of(b) * (b.size() - 1)) /
+                         (a.size() + b.size() - 2));
+    if (gap <= SPLIT_SIGMAS * pooled || gap <= SPLIT_REL * fabs(mean_of(a)))
+        return;
+    cut.push_back(best);
+    split_clusters(s, lo, best, cut);
+    split_clusters(s, best, hi, cut);
+}
+
+// Assign clusters and outliers; returns the number of clusters
+static int classify(vector<Sample>& samples, vector<vector<double>>& clusters) {
+    vector<double> sorted;
+    for (auto& x : samples) sorted.push_back(x.value);
+    sort(sorted.begin(), sorted.end());
+    vector<size_t> cut;
+    split_clusters(sorted, 0, sorted.size(), cut);
+    sort(cut.begin(), cut.end());
+
+    vector<double> bounds;      // first value of clusters 1..k-1
+    for (size_t c : cut) bounds.push_back(sorted[c]);
+    clusters.assign(cut.size() + 1, vector<double>());
+    for (auto& x : samples) {
+        x.cluster = upper_bound(bounds.begin(), bounds.end(), x.value) - bounds.begin();
+        clusters[x.cluster].push_back(x.value);
+    }
+    for (auto& c : clusters) sort(c.begin(), c.end());
+    for (auto& x : samples) {
+        const vector<double>& c = clusters[x.cluster];
+        double q1 = quantile(c, 0.25), q3 = quantile(c, 0.75);
+        x.outlier = x.value < q1 - 1.5 * (q3 - q1) || x.value > q3 + 1.5 * (q3 - q1);
+    }
+    return clusters.size();
+}
+
+// Governor of every allowed CPU, or "mixed" / "n/a"
+static string read_governor() {
+    cpu_set_t allowed;
+    string gov;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (!CPU_ISSET(c, &allowed))
+            continue;
+        char path[128], buf[64] = "";
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", c);
+        FILE* f = fopen(path, "r");
+        if (!f)
+            return "n/a";
+        if (!fgets(buf, sizeof(buf), f))
+            buf[0] = 0;
+        fclose(f);
+        buf[strcspn(buf, "\n")] = 0;
+        if (gov.empty())
+            gov = buf;
+        else if (gov != buf)
+            return "mixed";
+    }
+    return gov.empty() ? "n/a" : gov;
+}
+
+// CPU migrations of the child and all its threads, counting from exec
+static int open_migration_counter(pid_t pid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_CPU_MIGRATIONS;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    return syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+}
+
+static RunOutput run_once(char** argv) {
+    RunOutput r = { "", "", -1, -1 };
+    int out[2], err[2], go[2];
+    if (pipe(out) || pipe(err) || pipe(go)) {
+        perror("pipe");
+        exit(1);
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        char c;
+        dup2(out[1], 1);
+        dup2(err[1], 2);
+        close(out[0]); close(err[0]); close(go[1]);
+        // wait until the parent has attached the counter
+        if (read(go[0], &c, 1) < 0)
+            _exit(127);
+        execvp(argv[0], argv);
+        perror(argv[0]);
+        _exit(127);
+    }
+    close(out[1]); close(err[1]); close(go[0]);
+    int fd = open_migration_counter(pid);
+    if (write(go[1], "x", 1) < 0)
+        perror("write");
+    close(go[1]);
+
+    struct pollfd p[2] = { { out[0], POLLIN, 0 }, { err[0], POLLIN, 0 } };
+    string* dst[2] = { &r.out, &r.err };
+    int open_fds = 2;
+    while (open_fds > 0) {
+        if (poll(p, 2, -1) < 0)
+            break;
+        for (int i = 0; i < 2; i++) {
+            if (p[i].fd < 0 || !(p[i].revents & (POLLIN | POLLHUP)))
+                continue;
+            char buf[4096];
+            ssize_t n = read(p[i].fd, buf, sizeof(buf));
+            if (n <= 0) {
+                close(p[i].fd);
+                p[i].fd = -1;
+                open_fds--;
+            } else {
+                dst[i]->append(buf, n);
+            }
+        }
+    }
+    waitpid(pid, &r.status, 0);
+    if (fd >= 0) {
+        uint64_t v;
+        if (read(fd, &v, sizeof(v)) == sizeof(v))
+            r.migrations = (long long)v;
+        close(fd);
+    }
+    return r;
+}
+
+// Column `col` (1-based) of the last non-comment line
+static bool parse_metric(const string& out, int col, double* value) {
+    size_t end = out.size();
+    while (end > 0) {
+        size_t start = out.rfind('\n', end - 1);
+        start = start == string::npos ? 0 : start + 1;
+        string line = out.substr(start, end - start);
+        end = start > 0 ? start - 1 : 0;
+        if (line.empty() || line[0] == '#')
+            continue;
+        size_t pos = 0;
+        for (int i = 1; i < col; i++) {
+            pos = line.find(',', pos);
+            if (pos == string::npos)
+                return false;
+            pos++;
+        }
+        char* stop;
+        *value = strtod(line.c_str() + pos, &stop);
+        return stop != line.c_str() + pos;
+    }
+    return false;
+}
+
+static string parse_placement(const string& err) {
+    size_t p = err.find("# placement=");
+    if (p == string::npos)
+        return "n/a";
+    size_t e = err.find('\n', p);
+    return err.substr(p + 2, e == string::npos ? string::npos : e - p - 2);
+}
+
+static void usage(const char* exe) {
+    printf("usage: %s [--min-runs=<n>] [--max-runs=<n>] [--ci=<rel>] [--metric=<col>]"
+           " [--samples=<file>] -- <benchmark> <args...>\n", exe);
+}
+
+int main(int argc, char* argv[]) {
+    int min_runs = DEFAULT_MIN_RUNS, max_runs = DEFAULT_MAX_RUNS, metric = DEFAULT_METRIC;
+    double ci_target = DEFAULT_CI;
+    const char* samples_path = NULL;
+    int i;
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--") == 0) { i++; break; }
+        if (strncmp(argv[i], "--min-runs=", 11) == 0) min_runs = atoi(argv[i] + 11);
+        else if (strncmp(argv[i], "--max-runs=", 11) == 0) max_runs = atoi(argv[i] + 11);
+        else if (strncmp(argv[i], "--ci=", 5) == 0) ci_target = atof(argv[i] + 5);
+        else if (strncmp(argv[i], "--metric=", 9) == 0) metric = atoi(argv[i] + 9);
+        else if (strncmp(argv[i], "--samples=", 10) == 0) samples_path = argv[i] + 10;
+        else { usage(argv[0]); return 1; }
+    }
+    if (i >= argc || min_runs < 2 || max_runs < min_runs || metric < 1 || ci_target <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    char** cmd = &argv[i];
+
+    vector<Sample> samples;
+    vector<vector<double>> clusters;
+    int nclusters = 1;
+    while ((int)samples.size() < max_runs) {
+        Sample s;
+        s.governor = read_governor();
+        RunOutput r = run_once(cmd);
+        if (!WIFEXITED(r.status) || WEXITSTATUS(r.status) != 0 || !parse_metric(r.out, metric, &s.value)) {
+            fprintf(stderr, "Error: run %zu of '%s' failed or printed no column %d\n%s",
+                    samples.size() + 1, cmd[0], metric, r.err.c_str());
+            return 1;
+        }
+        s.migrations = r.migrations;
+        s.placement = parse_placement(r.err);
+        samples.push_back(s);
+
+        if ((int)samples.size() < min_runs)
+            continue;
+        nclusters = classify(samples, clusters);
+        bool stable = true;
+        for (auto& c : clusters)
+            if ((int)c.size() < min_runs || ci_rel(c) > ci_target)
+                stable = false;
+        if (stable)
+            break;
+    }
+    nclusters = classify(samples, clusters);
+
+    vector<double> all;
+    int outliers = 0;
+    for (auto& s : samples) {
+        all.push_back(s.value);
+        outliers += s.outlier;
+    }
+    sort(all.begin(), all.end());
+    double q1 = quantile(all, 0.25), q3 = quantile(all, 0.75);
+    printf("%zu,%f,%f,%f,%f,%f,%f,%d,%d,", samples.size(), quantile(all, 0.5), q1, q3,
+           q3 - q1, mean_of(all), ci_rel(all), nclusters, outliers);
+    for (int c = 0; c < nclusters; c++)
+        printf("%s%f@%zu", c ? ";" : "", quantile(clusters[c], 0.5), clusters[c].size());
+    printf("\n");
+    if (nclusters > 1)
+        fprintf(stderr, "runbench: %d clusters in %zu runs of %s\n", nclusters, samples.size(), cmd[0]);
+
+    if (samples_path) {
+        FILE* f = fopen(samples_path, "a");
+        if (!f) {
+            perror(samples_path);
+            return 1;
+        }
+        for (size_t k = 0; k < samples.size(); k++)
+            fprintf(f, "%zu,%f,%d,%d,%s,%lld,\"%s\"\n", k + 1, samples[k].value, samples[k].cluster,
+                    samples[k].outlier, samples[k].governor.c_str(), samples[k].migrations,
+                    samples[k].placement.c_str());
+        fclose(f);
+    }
+    return 0;
+}
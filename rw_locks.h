@@ -0,0 +1,210 @@
+#ifndef RW_LOCKS_H
+#define RW_LOCKS_H
+
+// Reader-writer locks whose readers do not all hit one shared counter.
+//
+// BRAVO (Dice & Kogan, "BRAVO: Biased Locking for Reader-Writer Locks")
+// goes in front of any existing RW lock.  While the lock is read-biased
+// (`rbias`), a reader publishes the lock's address in one slot of a
+// global visible-readers table, picked by hashing the lock and the
+// thread, and is done; on a slot collision, or with the bias off, it
+// takes the underlying read lock.  A writer takes the underlying write
+// lock, clears the bias and waits until no slot holds the lock any more.
+// Revocation is slow, so the bias stays off for BRAVO_INHIBIT times as
+// long as the last revocation took; the next slow-path reader after
+// that turns it back on.  BRAVO has no lock of its own: the caller
+// wraps its RW lock as
+//   read:    if (!bravo_read_fast(b)) { rdlock(); bravo_read_slow(b); }
+//   unread:  if (!bravo_read_release(b)) rdunlock();
+//   write:   wrlock(); bravo_revoke(b);
+//   unwrite: wrunlock();
+// A thread can hold BRAVO_MAX_HELD fast-path read locks at once; beyond
+// that it reads through the underlying lock.
+//
+// drw_lock_t is a distributed RW lock with one reader indicator per CPU
+// (DRW_PER_CPU) or per NUMA node (DRW_PER_NODE), each on its own cache
+// line.  A reader bumps the indicator of the CPU or node it found itself
+// on at its first acquisition (so pin before locking) and backs off while
+// a writer is active; a writer serialises on a futex mutex, raises
+// `writer` and waits for every indicator to drain.  Writers win over new
+// readers.
+//
+// Neither is reentrant.  Plain C so the .c harnesses can include it as
+// well; needs _GNU_SOURCE.
+
+#include <sched.h>
+#include <stdint.h>
+#include <time.h>
+#include "placement.h"
+#include "queue_locks.h"        // ql_backoff()
+#include "futex_mutex.h"
+
+#define BRAVO_TABLE_SIZE 4096   // visible-readers slots, shared by all locks
+#define BRAVO_INHIBIT 9         // bias off for this many revocation times
+#define BRAVO_MAX_HELD 8
+#define DRW_MAX_SLOTS 256       // per-CPU indicators; CPUs beyond share them
+
+static void* bravo_table[BRAVO_TABLE_SIZE] __attribute__((aligned(64)));
+
+static __thread void** bravo_held[BRAVO_MAX_HELD];
+static __thread int bravo_nheld;
+
+typedef struct {
+    int rbias;
+    uint64_t inhibit_until;     // ns, CLOCK_MONOTONIC
+} bravo_t;
+
+static inline uint64_t bravo_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline void bravo_init(bravo_t* b) {
+    b->rbias = 1;
+    b->inhibit_until = 0;
+}
+
+static inline void** bravo_slot(bravo_t* b) {
+    uintptr_t h = (uintptr_t)b ^ ((uintptr_t)&bravo_nheld >> 6) * 0x9E3779B97F4A7C15ull;     // lock x thread
+    return &bravo_table[(h * 0x9E3779B97F4A7C15ull) >> 52 & (BRAVO_TABLE_SIZE - 1)];
+}
+
+// 1 if the read lock was taken through the table
+static inline int bravo_read_fast(bravo_t* b) {
+    if (!__atomic_load_n(&b->rbias, __ATOMIC_RELAXED) || bravo_nheld == BRAVO_MAX_HELD)
+        return 0;
+    void** slot = bravo_slot(b);
+    void* expected = NULL;
+    if (!__atomic_compare_exchange_n(slot, &expected, (void*)b, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return 0;
+    if (__atomic_load_n(&b->rbias, __ATOMIC_SEQ_CST)) {
+        bravo_held[bravo_nheld++] = slot;
+        return 1;
+    }
+    __atomic_store_n(slot, NULL, __ATOMIC_RELEASE);    // a writer is revoking
+    return 0;
+}
+
+// After a slow-path read acquisition: turn the bias back on once the
+// inhibition period is over
+static inline void bravo_read_slow(bravo_t* b) {
+    if (!__atomic_load_n(&b->rbias, __ATOMIC_RELAXED) &&
+        bravo_now_ns() >= __atomic_load_n(&b->inhibit_until, __ATOMIC_RELAXED))
+        __atomic_store_n(&b->rbias, 1, __ATOMIC_RELEASE);
+}
+
+// 1 if the read lock was held through the table and is now released
+static inline int bravo_read_release(bravo_t* b) {
+    for (int i = 0; i < bravo_nheld; i++) {
+        if (*bravo_held[i] == (void*)b) {
+            __atomic_store_n(bravo_held[i], NULL, __ATOMIC_RELEASE);
+            bravo_held[i] = bravo_held[--bravo_nheld];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// With the underlying write lock held: wait out the fast-path readers
+static inline void bravo_revoke(bravo_t* b) {
+    if (!__atomic_load_n(&b->rbias, __ATOMIC_RELAXED))
+        return;
+    uint64_t t0 = bravo_now_ns();
+    __atomic_store_n(&b->rbias, 0, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < BRAVO_TABLE_SIZE; i++) {
+        int spins = 0;
+        while (__atomic_load_n(&bravo_table[i], __ATOMIC_ACQUIRE) == (void*)b)
+            ql_backoff(&spins);
+    }
+    uint64_t t1 = bravo_now_ns();
+    __atomic_store_n(&b->inhibit_until, t1 + (t1 - t0) * BRAVO_INHIBIT, __ATOMIC_RELAXED);
+}
+
+// Distributed reader indicators
+
+#define DRW_PER_CPU 0
+#define DRW_PER_NODE 1
+
+struct drw_indicator {
+    int readers;
+} __attribute__((aligned(64)));
+
+typedef struct {
+    int writer;
+    int nslots;
+    int per_node;
+    futex_mutex_t writers;
+    struct drw_indicator slot[DRW_MAX_SLOTS] __attribute__((aligned(64)));
+} drw_lock_t;
+
+static __thread int drw_self_cpu = -1;
+static __thread int drw_self_node;
+
+static inline void drw_init(drw_lock_t* l, int per_node) {
+    if (placement.ncpus == 0)
+        placement_init("none");
+    int n = 1;
+    for (int i = 0; i < placement.ncpus; i++) {
+        int id = per_node ? placement.cpus[i].node : placement.cpus[i].cpu;
+        if (id + 1 > n)
+            n = id + 1;
+    }
+    l->writer = 0;
+    l->nslots = n < DRW_MAX_SLOTS ? n : DRW_MAX_SLOTS;
+    l->per_node = per_node;
+    futex_mutex_init(&l->writers);
+    for (int i = 0; i < DRW_MAX_SLOTS; i++)
+        l->slot[i].readers = 0;
+}
+
+static inline void drw_destroy(drw_lock_t* l) {
+    futex_mutex_destroy(&l->writers);
+}
+
+static inline struct drw_indicator* drw_my_slot(drw_lock_t* l) {
+    if (drw_self_cpu < 0) {
+        drw_self_cpu = sched_getcpu();
+        if (drw_self_cpu < 0)
+            drw_self_cpu = 0;
+        drw_self_node = placement_node_of_cpu(drw_self_cpu);
+    }
+    int id = l->per_node ? drw_self_node : drw_self_cpu;
+    return &l->slot[id % l->nslots];
+}
+
+static inline void drw_read_lock(drw_lock_t* l) {
+    struct drw_indicator* s = drw_my_slot(l);
+    for (;;) {
+        __atomic_fetch_add(&s->readers, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&l->writer, __ATOMIC_SEQ_CST))
+            return;
+        __atomic_fetch_sub(&s->readers, 1, __ATOMIC_RELEASE);
+        int spins = 0;
+        while (__atomic_load_n(&l->writer, __ATOMIC_RELAXED))
+            ql_backoff(&spins);
+    }
+}
+
+static inline void drw_read_unlock(drw_lock_t* l) {
+    __atomic_fetch_sub(&drw_my_slot(l)->readers, 1, __ATOMIC_RELEASE);
+}
+
+static inline void drw_write_lock(drw_lock_t* l) {
+    futex_mutex_lock(&l->writers);
+    // Dekker with drw_read_lock: seq_cst on both sides, so the store of
+    // `writer` is ordered before the indicator loads
+    __atomic_store_n(&l->writer, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < l->nslots; i++) {
+        int spins = 0;
+        while (__atomic_load_n(&l->slot[i].readers, __ATOMIC_SEQ_CST))
+            ql_backoff(&spins);
+    }
+}
+
+static inline void drw_write_unlock(drw_lock_t* l) {
+    __atomic_store_n(&l->writer, 0, __ATOMIC_RELEASE);
+    futex_mutex_unlock(&l->writers);
+}
+
+#endif // RW_LOCKS_H
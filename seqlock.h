@@ -0,0 +1,60 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+// Sequence lock for small read-mostly data: readers never write the lock
+// line, they read optimistically and retry if a writer got in between.
+//
+//   read:   do { v = seq_read_begin(s); <copy the data>; } while (!seq_read_validate(s, v));
+//   write:  <take the writers' lock>; seq_write_begin(s); <update>; seq_write_end(s); <release>
+//
+// seq_t itself does not exclude writers from each other; any lock does
+// that (lockbench pairs it with several of its backends).  The count is
+// odd while a write is in progress.  Readers must only copy the data and
+// look at the copy once seq_read_validate() has passed, and should read
+// it with relaxed atomic loads, since a writer may change it under them.
+// Failed validations are counted per thread in seq_read_retries.
+//
+// Plain C so the .c harnesses can include it as well.
+
+#include <stdint.h>
+#include "queue_locks.h"        // ql_backoff()
+
+typedef struct {
+    unsigned seq;
+} seq_t;
+
+static __thread uint64_t seq_read_retries;
+
+static inline void seq_init(seq_t* s) {
+    s->seq = 0;
+}
+
+// Wait out a writer in progress; returns the count to validate against
+static inline unsigned seq_read_begin(seq_t* s) {
+    int spins = 0;
+    unsigned v;
+    while ((v = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE)) & 1)
+        ql_backoff(&spins);
+    return v;
+}
+
+// 1 if no writer touched the data since seq_read_begin() returned v
+static inline int seq_read_validate(seq_t* s, unsigned v) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == v)
+        return 1;
+    seq_read_retries++;
+    return 0;
+}
+
+// With the writers' lock held
+static inline void seq_write_begin(seq_t* s) {
+    __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void seq_write_end(seq_t* s) {
+    __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELEASE);
+}
+
+#endif // SEQLOCK_H
@@ -0,0 +1,132 @@
+#ifndef TICKET_LOCKS_H
+#define TICKET_LOCKS_H
+
+// FIFO ticket locks without queue nodes: every waiter draws a ticket and
+// waits for the grant counter to reach it.
+//
+//   ticket_lock_t    classic ticket lock; a waiter pauses in proportion to
+//                    how many tickets are still ahead of it between polls
+//                    of the shared grant, so only the next in line polls
+//                    it hard (Mellor-Crummey & Scott)
+//   pticket_lock_t   partitioned ticket lock (Dice): the grant is spread
+//                    over PTICKET_SLOTS cache lines and ticket t waits on
+//                    slot t % PTICKET_SLOTS, so a release invalidates only
+//                    the waiters of one slot
+//   twa_lock_t       ticket lock with a waiting array (Dice & Kogan):
+//                    waiters more than TWA_LONG_TERM tickets away sleep-spin
+//                    on a slot of one global hashed array and only the
+//                    next in line polls the grant itself
+//
+// All spin only and are not reentrant.  Counters are unsigned and compared
+// by difference, so they may wrap.
+//
+// Plain C so the .c harnesses can include it as well.
+
+#include <stdint.h>
+#include "queue_locks.h"        // ql_pause()
+
+#define TICKET_BACKOFF_BASE 64      // pauses per waiter ahead
+#define PTICKET_SLOTS 8
+#define TWA_ARRAY_SIZE 4096
+#define TWA_LONG_TERM 1             // tickets ahead before using the array
+
+typedef struct {
+    unsigned next;                                      // next ticket to hand out
+    unsigned grant __attribute__((aligned(64)));        // ticket now served
+} ticket_lock_t;
+
+static inline void ticket_init(ticket_lock_t* l) {
+    l->next = 0;
+    l->grant = 0;
+}
+
+static inline void ticket_lock(ticket_lock_t* l) {
+    unsigned t = __atomic_fetch_add(&l->next, 1, __ATOMIC_RELAXED);
+    for (;;) {
+        unsigned ahead = t - __atomic_load_n(&l->grant, __ATOMIC_ACQUIRE);
+        if (ahead == 0)
+            return;
+        for (unsigned i = 0; i < (ahead - 1) * TICKET_BACKOFF_BASE + 1; i++)
+            ql_pause();
+    }
+}
+
+static inline void ticket_unlock(ticket_lock_t* l) {
+    __atomic_store_n(&l->grant, l->grant + 1, __ATOMIC_RELEASE);
+}
+
+struct pticket_slot {
+    unsigned grant;
+} __attribute__((aligned(64)));
+
+typedef struct {
+    unsigned request;
+    unsigned owner;                     // holder's ticket, for unlock
+    struct pticket_slot slot[PTICKET_SLOTS] __attribute__((aligned(64)));
+} pticket_lock_t;
+
+static inline void pticket_init(pticket_lock_t* l) {
+    l->request = 0;
+    l->owner = 0;
+    // only slot 0 admits its first ticket; slot i starts a full round back
+    for (unsigned i = 0; i < PTICKET_SLOTS; i++)
+        l->slot[i].grant = i - (i ? PTICKET_SLOTS : 0);
+}
+
+static inline void pticket_lock(pticket_lock_t* l) {
+    unsigned t = __atomic_fetch_add(&l->request, 1, __ATOMIC_RELAXED);
+    struct pticket_slot* s = &l->slot[t % PTICKET_SLOTS];
+    while (__atomic_load_n(&s->grant, __ATOMIC_ACQUIRE) != t)
+        ql_pause();
+    l->owner = t;
+}
+
+static inline void pticket_unlock(pticket_lock_t* l) {
+    unsigned t = l->owner + 1;
+    __atomic_store_n(&l->slot[t % PTICKET_SLOTS].grant, t, __ATOMIC_RELEASE);
+}
+
+// Shared by every TWA lock; a release bumps the slot of the ticket that
+// has just become next in line
+static unsigned twa_wait_array[TWA_ARRAY_SIZE] __attribute__((aligned(64)));
+
+typedef struct {
+    unsigned ticket;
+    unsigned grant __attribute__((aligned(64)));
+} twa_lock_t;
+
+static inline unsigned* twa_slot(twa_lock_t* l, unsigned t) {
+    return &twa_wait_array[(((uintptr_t)l >> 6) * 127 + t) & (TWA_ARRAY_SIZE - 1)];
+}
+
+static inline void twa_init(twa_lock_t* l) {
+    l->ticket = 0;
+    l->grant = 0;
+}
+
+static inline void twa_lock(twa_lock_t* l) {
+    unsigned t = __atomic_fetch_add(&l->ticket, 1, __ATOMIC_RELAXED);
+    unsigned ahead = t - __atomic_load_n(&l->grant, __ATOMIC_ACQUIRE);
+    if (ahead == 0)
+        return;
+    if (ahead > TWA_LONG_TERM) {
+        unsigned* at = twa_slot(l, t);
+        for (;;) {
+            unsigned seq = __atomic_load_n(at, __ATOMIC_ACQUIRE);
+            if (t - __atomic_load_n(&l->grant, __ATOMIC_ACQUIRE) <= TWA_LONG_TERM)
+                break;
+            while (__atomic_load_n(at, __ATOMIC_ACQUIRE) == seq)
+                ql_pause();
+        }
+    }
+    while (__atomic_load_n(&l->grant, __ATOMIC_ACQUIRE) != t)
+        ql_pause();
+}
+
+static inline void twa_unlock(twa_lock_t* l) {
+    unsigned k = l->grant + 1;
+    __atomic_store_n(&l->grant, k, __ATOMIC_RELEASE);
+    __atomic_fetch_add(twa_slot(l, k + TWA_LONG_TERM), 1, __ATOMIC_RELEASE);
+}
+
+#endif // TICKET_LOCKS_H